@@ -23,6 +23,7 @@
 #include "draw_text.hpp"
 #include "room_controller.hpp"
 #include "freetype/glue.hpp"
+#include "font_cache.hpp"
 #include "assets_config.hpp"
 #include "platform/asset_access.hpp"
 #include "png/image_queue.hpp"
@@ -86,8 +87,7 @@ bool application::execute_commands(const bool is_nested) noexcept
                 update_display = false;
                 if (pause)
                 {
-                    for (auto& it : pause->buffers)
-                        it.reset();
+                    pause->release();
                 }
                 opengl.clean();
                 window.terminate_display();
@@ -113,7 +113,12 @@ bool application::execute_commands(const bool is_nested) noexcept
 
         window.commands.clear();
 
-        if (perform_load && !opengl.setup_graphics()) return false;
+        if (perform_load)
+        {
+            first_frame_since = std::chrono::steady_clock::now();
+
+            if (!opengl.setup_graphics()) return false;
+        }
     }
 
     if (window.cursor_update && !pause)
@@ -167,13 +172,6 @@ GLint setup_unmasked_buffer_frame(const graphics::render_buffer_t& rb, const idl
     return default_frame_buffer;
 }
 
-void fill_frame_with_color(const idle::color_t& color) noexcept
-{
-    opengl.prog.fill.set_color(color);
-    opengl.prog.fill.position_vertex(opengl.draw_bounds_verts.data());
-    gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
-}
-
 GLint setup_drawing_buffer_frame(const graphics::render_buffer_t& rb, const idle::color_t& bg) noexcept
 {
     GLint default_frame_buffer;
@@ -183,16 +181,17 @@ GLint setup_drawing_buffer_frame(const graphics::render_buffer_t& rb, const idle
     gl::ClearColor(bg.r, bg.g, bg.b, 1);
     gl::Clear(gl::COLOR_BUFFER_BIT | gl::DEPTH_BUFFER_BIT);
 
-    opengl.prog.fill.use();
-    opengl.prog.fill.set_identity();
-    opengl.prog.fill.set_view_identity();
-
-    opengl.view_mask();
-    fill_frame_with_color({1,1,1,1});
+    const auto& prog = opengl.prog.dual_fill;
+    prog.use();
+    prog.set_identity();
+    prog.set_view_identity();
 
     constexpr idle::color_t draw_background{ .35f, .3f, .35f };
-    opengl.view_normal();
-    fill_frame_with_color(draw_background);
+    prog.set_mask_color({1,1,1,1});
+    prog.set_color(draw_background);
+    prog.position_vertex(opengl.draw_bounds_verts.data());
+
+    opengl.draw_views(prog, [&prog] { prog.draw_arrays(gl::TRIANGLE_STRIP, 0, 4); });
 
     return default_frame_buffer;
 }
@@ -210,6 +209,7 @@ public:
 
     ~render_guard()
     {
+        const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::composite };
         gl::BindFramebuffer(gl::FRAMEBUFFER, default_frame_buffer);
         gl::Viewport(0, 0, opengl.screen_size.x, opengl.screen_size.y);
         opengl.prog.render_masked.draw_buffer(*opengl.render_buffer_masked);
@@ -234,6 +234,9 @@ auto wait_one_frame_with_skipping(std::chrono::steady_clock::time_point new_time
 
 void pause_menu::draw() const noexcept
 {
+    if (!scene)
+        return;
+
     const float glare = std::sin(shift);
     const auto glare_sqr = math::sqr(glare);
 
@@ -241,87 +244,113 @@ void pause_menu::draw() const noexcept
     opengl.prog.normal.set_identity();
     opengl.prog.normal.set_view_identity();
 
+    const auto& blurred = blur.result();
+
     const float t[] {
-        0, buffers[0]->texture_h,
-        buffers[0]->texture_w, buffers[0]->texture_h,
+        0, scene->texture_h,
+        scene->texture_w, scene->texture_h,
         0, 0,
-        buffers[0]->texture_w, 0
+        scene->texture_w, 0
     };
 
     const float tb[] {
-        0, buffers[1]->texture_h,
-        buffers[1]->texture_w, buffers[1]->texture_h,
+        0, blurred.texture_h,
+        blurred.texture_w, blurred.texture_h,
         0, 0,
-        buffers[1]->texture_w, 0
+        blurred.texture_w, 0
     };
 
-    gl::ActiveTexture(gl::TEXTURE0);
     opengl.prog.normal.set_color({1, 1, 1, 1 - fadein_alpha * .666f});
-    gl::BindTexture(gl::TEXTURE_2D, buffers[0]->texture);
+    graphics::state::bind_texture(scene->texture);
     opengl.prog.normal.position_vertex(opengl.draw_bounds_verts.data());
     opengl.prog.normal.texture_vertex(t);
     gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
 
     opengl.prog.normal.set_color({1, 1 - fadein_alpha * .2f, 1 - fadein_alpha * .1f, fadein_alpha * .998f});
-    gl::BindTexture(gl::TEXTURE_2D, buffers[1]->texture);
+    graphics::state::bind_texture(blurred.texture);
     opengl.prog.normal.texture_vertex(tb);
     gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
 
     const auto y_shift = opengl.draw_size.y / 2 - 60.f + (1 - fadein_alpha) * 20;
 
-    opengl.prog.text.use();
-    opengl.prog.text.set_color({1, .733f, .796f, fadein_alpha});
+    opengl.prog.sdf_text.use();
+    opengl.prog.sdf_text.set_color({1, .733f, .796f, fadein_alpha});
+    opengl.prog.sdf_text.set_glow({1, .733f, .796f, .4f * fadein_alpha}, .3f);
 
-    idle::draw_text<idle::text_align::center>(*opengl.fonts.regular, opengl.prog.text,
+    idle::draw_text<idle::text_align::center>(*opengl.fonts.regular, opengl.prog.sdf_text,
             "paused", {opengl.draw_size.x / 2.f, y_shift}, 64);
 
+    opengl.prog.sdf_text.set_glow({0, 0, 0, 0}, 0);
+
     if (fadein_alpha > .8f)
     {
-        opengl.prog.text.set_color({1, .733f, .796f, (fadein_alpha - .8f) / .2f * (1 - glare_sqr * .5f)});
+        opengl.prog.sdf_text.set_color({1, .733f, .796f, (fadein_alpha - .8f) / .2f * (1 - glare_sqr * .5f)});
 
-        idle::draw_text<idle::text_align::center>(*opengl.fonts.regular, opengl.prog.text,
+        idle::draw_text<idle::text_align::center>(*opengl.fonts.regular, opengl.prog.sdf_text,
                 "press to resume", {opengl.draw_size.x / 2.f, 80.f + y_shift}, 20);
     }
 }
 
-pause_menu::pause_menu(const unsigned blur_downscale) noexcept
-    : buffers
+pause_menu::pause_menu(const unsigned blur_levels) noexcept
+    : scene
     {
-        opengl.new_render_buffer(),
-        opengl.new_render_buffer(blur_downscale)
+        opengl.new_render_buffer()
+    },
+    blur
+    {
+        opengl, opengl.viewport_size, blur_levels
     },
     finish_time
     {
         std::chrono::steady_clock::now() + std::chrono::seconds(2)
     }
 {
-    const graphics::render_buffer_t intermediate_buffer {opengl.render_buffer_masked->internal_size, opengl.render_quality};
-    const auto intermediate_masked_buffer = opengl.new_render_buffer(blur_downscale);
-    const auto def = setup_drawing_buffer_frame(intermediate_buffer, uniform_background);
+    const auto intermediate_buffer = opengl.render_targets.acquire(opengl.render_buffer_masked->internal_size, opengl.render_quality);
+    const auto def = setup_drawing_buffer_frame(*intermediate_buffer, uniform_background);
 
-    room_ctrl.draw_frame(opengl);
+    {
+        const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::scene };
+        room_ctrl.draw_frame(opengl);
+    }
 
-    setup_unmasked_buffer_frame(*buffers[0], uniform_background);
-    opengl.prog.render_masked.draw_buffer(intermediate_buffer);
+    {
+        const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::composite };
+        setup_unmasked_buffer_frame(*scene, uniform_background);
+        opengl.prog.render_masked.draw_buffer(*intermediate_buffer);
+    }
 
-    opengl.prog.render_blur.use();
-    opengl.prog.render_blur.set_radius(2);
-    opengl.prog.render_blur.set_direction(0, 1);
+    gl::BindFramebuffer(gl::FRAMEBUFFER, def);
+    update_blur();
+}
 
-    setup_unmasked_buffer_frame(*intermediate_masked_buffer, graphics::black);
-    opengl.prog.render_blur.draw_buffer(*buffers[0]);
+void pause_menu::update_blur() noexcept
+{
+    constexpr float max_blur_offset = 2.5f;
 
-    opengl.prog.render_blur.use();
-    opengl.prog.render_blur.set_direction(1, 0);
+    if (!scene || blurred_alpha == fadein_alpha)
+        return;
 
-    setup_unmasked_buffer_frame(*buffers[1], graphics::black);
-    opengl.prog.render_blur.draw_buffer(*intermediate_masked_buffer);
+    const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::blur };
+    blur.apply(opengl, *scene, fadein_alpha * max_blur_offset);
+    blurred_alpha = fadein_alpha;
+}
 
-    gl::BindFramebuffer(gl::FRAMEBUFFER, def);
+void pause_menu::release() noexcept
+{
+    scene.reset();
+    blur.reset();
+    blurred_alpha = -1;
 }
 
 void application::draw() noexcept
 {
+    opengl.stream.next_frame();
+    graphics::state::next_frame();
+    opengl.timer.next_frame();
+#ifdef IDLE_COMPILE_GL_TRACE
+    gl::trace::NextFrame();
+#endif
+
     if (blank_display)
     {
         gl::ClearColor(0, 0, 0, 1);
@@ -329,10 +358,16 @@ void application::draw() noexcept
     }
     else if (pause)
     {
+        pause->update_blur();
+
         const render_guard rg {};
-        pause->draw();
+        {
+            const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::scene };
+            pause->draw();
+        }
 
 #ifdef IDLE_COMPILE_FPS_COUNTERS
+        const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::overlay };
         room_ctrl.teller.draw_fps(opengl);
         room_ctrl.tick_counter.draw_fps(opengl);
 #endif
@@ -340,14 +375,38 @@ void application::draw() noexcept
     else
     {
         const render_guard rg {};
-        room_ctrl.draw_frame(opengl);
+        {
+            const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::scene };
+            room_ctrl.draw_frame(opengl);
+        }
 
 #ifdef IDLE_COMPILE_FPS_COUNTERS
+        const graphics::gpu_scope pass{ opengl.timer, graphics::gpu_pass::overlay };
         room_ctrl.teller.draw_fps(opengl);
         room_ctrl.tick_counter.draw_fps(opengl);
 #endif
     }
+
+    // A program first used by this frame may have failed to link
+    if (opengl.builder.has_failed() && !room_ctrl.haiku.has_crashed())
+    {
+        room_ctrl.sleep();
+        room_ctrl.haiku.crash("Some programs failed to link");
+    }
+    present();
+}
+
+void application::present() noexcept
+{
     window.buffer_swap();
+
+    if (first_frame_since)
+    {
+        LOGI("First frame presented %.1f ms after init_window, %zu programs still pending",
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - *first_frame_since).count(),
+                opengl.builder.pending_count());
+        first_frame_since.reset();
+    }
 }
 
 #define PRINT_SIZE(obj) LOGD("# sizeof " #obj " = %zu", sizeof(obj))
@@ -398,6 +457,7 @@ int application::real_main() noexcept
         if (app.window.has_opengl())
         {
             room_ctrl.load_queued_images();
+            graphics::state::forget_texture();
 
             if (app.update_display)
             {
@@ -405,6 +465,8 @@ int application::real_main() noexcept
             }
 
             idle::images::database::clean_trash();
+            graphics::vertex_buffer::clean_trash();
+            graphics::state::forget_texture();
         }
 
         app.clock = wait_one_frame_with_skipping(app.clock);
@@ -428,35 +490,30 @@ constexpr bool ext_ascii(const unsigned long c) noexcept
     return (c >= 0x20 && c < 0x17f);
 }
 
-fonts::font_t make_font(idle::images::loader& db, fonts::ft_data_t font_data) noexcept
+// Small enough to keep texture memory down, yet roomy enough for a screen of text
+fonts::font_t make_font(const std::string_view name, fonts::rasterizer raster, bool (* filter_function)(unsigned long), const fonts::texture_quality resolution, const unsigned thread_count, graphics::stream_buffer& stream) noexcept
 {
-    auto image = graphics::unique_texture(db.load_from_memory(
-                font_data.width, font_data.width,
-#ifdef __ANDROID__
-                gl::LUMINANCE, gl::LUMINANCE,
-#else
-                gl::R8, gl::RED,
-#endif
-                gl::LINEAR, gl::CLAMP_TO_EDGE, std::move(font_data.pixels)));
+    constexpr unsigned cached_columns = 12;
+    unsigned page_side = 1;
+    while (page_side < cached_columns * raster.cell_size())
+        page_side *= 2;
+    page_side = std::min(page_side, static_cast<unsigned>(resolution));
 
-    const auto comp = [](const auto& left, const auto& right) -> bool
-            {
-                return left.second.offset.y < right.second.offset.y;
-            };
+    std::vector<unsigned long> printable_ascii;
+    for (unsigned long c = 0x20; c < 0x7f; ++c)
+        printable_ascii.push_back(c);
 
-    const auto min_y = std::min_element(font_data.map.begin(), font_data.map.end(), comp)->second.offset.y;
+    const fonts::page_cache cache{ name, raster, filter_function, printable_ascii, page_side };
+    auto page = cache.load();
 
-    const auto max_y = std::max_element(font_data.map.begin(), font_data.map.end(), comp)->second.offset.y;
-
-    LOGDD("Font bbox [%.3f <=> %.3f] : %.3f", min_y, max_y, min_y - max_y);
+    if (!page)
+    {
+        page = raster.render_page(printable_ascii, page_side, thread_count);
+        cache.store(*page);
+    }
 
-    return {
-        std::move(image),
-        std::move(font_data.map),
-        font_data.cell_size,
-        min_y,
-        max_y
-    };
+    LOGDD("Font bbox [%.3f <=> %.3f] : %.3f", raster.top(), raster.bottom(), raster.top() - raster.bottom());
+    return { std::move(raster), page_side, std::move(*page), stream };
 }
 
 }  // namespace
@@ -474,36 +531,47 @@ bool application::load() noexcept
 
     LOGI("Asset refresh requested");
 
+    auto regular_font_file = platform::asset::hold_async(idle::config::regular_font_asset);
+    auto title_font_file = platform::asset::hold_async(idle::config::title_font_asset);
+
     idle::lodge la {
         idle::image_t::load_from_assets_immediate("path4368.png"),
         idle::image_t::load_from_assets_immediate("space-1.png")
     };
 
-    idle::images::loader queue;
     auto lt = std::chrono::steady_clock::now();
     bool success = false;
 
     std::thread loader_thread {
-        [&queue, &promise = success, &flag = la.load_status]
+        [&promise = success, &flag = la.load_status, &regular_font_file, &title_font_file]
         {
-            const fonts::freetype_glue freetype {};
+            constexpr auto regular_quality = fonts::texture_quality::ok, title_quality = fonts::texture_quality::poor;
+            const unsigned threads_per_font = std::max(1u, std::thread::hardware_concurrency() / 2);
 
-            if (const auto unicode_font = platform::asset::hold(idle::config::regular_font_asset))
-            {
-                if (auto ft = freetype(ext_ascii_plus_math, unicode_font.view(), fonts::texture_quality::ok))
+            std::thread title_thread {
+                [&title_font_file, threads_per_font]
                 {
-                    opengl.fonts.regular.emplace(make_font(queue, std::move(*ft)));
-                }
-            }
-
-            if (const auto title_font = platform::asset::hold(idle::config::title_font_asset))
+                    if (auto title_font = std::make_shared<platform::asset>(title_font_file.get()); !!*title_font)
+                    {
+                        const auto memory = title_font->view();
+                        if (auto raster = fonts::rasterizer::open(ext_ascii, memory, std::move(title_font), title_quality))
+                        {
+                            opengl.fonts.title.emplace(make_font("title_glyphs.bin", std::move(*raster), ext_ascii, title_quality, threads_per_font, opengl.stream));
+                        }
+                    }
+                }};
+
+            if (auto unicode_font = std::make_shared<platform::asset>(regular_font_file.get()); !!*unicode_font)
             {
-                if (auto ft = freetype(ext_ascii, title_font.view(), fonts::texture_quality::poor))
+                const auto memory = unicode_font->view();
+                if (auto raster = fonts::rasterizer::open(ext_ascii_plus_math, memory, std::move(unicode_font), regular_quality, fonts::glyph_style::distance_field))
                 {
-                    opengl.fonts.title.emplace(make_font(queue, std::move(*ft)));
+                    opengl.fonts.regular.emplace(make_font("regular_glyphs.bin", std::move(*raster), ext_ascii_plus_math, regular_quality, threads_per_font, opengl.stream));
                 }
             }
 
+            title_thread.join();
+
             promise = opengl.fonts.regular && opengl.fonts.title;
             flag.store(true, std::memory_order_release);
         }};
@@ -526,16 +594,25 @@ bool application::load() noexcept
                     const render_guard rg {};
                     la.draw(opengl);
                 }
-                window.buffer_swap();
+                present();
 
                 la.tick();
             }
 
-            queue.load_topmost_queued_picture();
+            graphics::state::forget_texture();
+            opengl.builder.poll();
         }
     }
 
     loader_thread.join();
+    platform::asset::log_prefetch_counters();
+
+    // Only links polled to completion are known here, the rest fail on first use
+    if (window.has_opengl() && opengl.builder.has_failed())
+    {
+        LOGE("Some programs failed to link");
+        return false;
+    }
 
 #ifdef IDLE_COMPILE_FONT_DEBUG_SCREEN
     if (!!window.has_opengl())
@@ -551,9 +628,8 @@ bool application::load() noexcept
             math::transform::translate(mat, opengl.draw_size / 2);
             opengl.prog.normal.set_view_transform(mat);
 
-            gl::ActiveTexture(gl::TEXTURE0);
             opengl.prog.normal.set_color({1, 1, 1, 1});
-            gl::BindTexture(gl::TEXTURE_2D, opengl.fonts.regular->texture.get());
+            graphics::state::bind_texture(opengl.fonts.regular->cache.texture.get());
             opengl.prog.normal.position_vertex(opengl.draw_bounds_verts.data());
             opengl.prog.normal.texture_vertex(opengl.texture_bounds_verts.data());
             gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
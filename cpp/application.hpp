@@ -29,13 +29,19 @@ namespace outside
 
 struct pause_menu
 {
-    std::unique_ptr<const graphics::render_buffer_t> buffers[2];
-    float fadein_alpha = 0, shift = 0;
+    graphics::render_target scene;
+    graphics::dual_blur blur;
+    float fadein_alpha = 0, shift = 0, blurred_alpha = -1;
     std::chrono::steady_clock::time_point finish_time;
 
-    pause_menu(unsigned blur_downscale) noexcept;
+    pause_menu(unsigned blur_levels) noexcept;
+
+    // Widens the blur of the captured scene along with the fade-in
+    void update_blur() noexcept;
 
     void draw() const noexcept;
+
+    void release() noexcept;
 };
 
 struct application
@@ -44,6 +50,7 @@ private:
     bool update_display = false, blank_display = true;
     std::chrono::system_clock::time_point earliest_available_resize;
     std::chrono::steady_clock::time_point clock = std::chrono::steady_clock::now();
+    std::optional<std::chrono::steady_clock::time_point> first_frame_since;
 
 public:
     std::optional<pause_menu> pause;
@@ -55,6 +62,8 @@ private:
 
     auto execute_commands(const bool nested) noexcept -> bool;
 
+    void present() noexcept;
+
 public:
     static auto real_main() noexcept -> int;
 
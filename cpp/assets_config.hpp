@@ -25,4 +25,8 @@ constexpr char regular_font_asset[] = "NipCen_s_Print_Unicode.ttf";
 
 constexpr char title_font_asset[] = "Piedra-Regular.ttf";
 
+constexpr char octavia_texture_asset[] = "octavia_tex.png";
+
+constexpr char debug_texture_asset[] = "debug_tex.png";
+
 }  // namespace idle::config
@@ -0,0 +1,81 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <log.hpp>
+
+// Shared by the files kept in platform::cache_path
+namespace idle::cache_file
+{
+
+using unique_file = std::unique_ptr<FILE, decltype([](FILE* f){ std::fclose(f); })>;
+
+// FNV-1a
+constexpr std::uint64_t hash_offset = 0xcbf29ce484222325ull;
+
+inline std::uint64_t hash(std::uint64_t h, const std::string_view data) noexcept
+{
+    for (const auto c : data)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ull;
+    }
+    // separates consecutive strings
+    h ^= 0xff;
+    h *= 0x100000001b3ull;
+    return h;
+}
+
+// The contents go to a temporary first and replace the file only once complete, so that
+// a reader never sees half of it; write receives the open file and reports success
+template<typename Writer>
+bool replace(const std::string& path, Writer&& write) noexcept
+{
+    const auto temporary = path + ".tmp";
+    bool good = false;
+
+    if (const unique_file f{ std::fopen(temporary.c_str(), "wb") })
+    {
+        good = write(f.get()) && std::fflush(f.get()) == 0;
+    }
+
+    if (!good)
+    {
+        LOGW("Couldn't write \"%s\"", temporary.c_str());
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        LOGW("Couldn't replace \"%s\"", path.c_str());
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+}  // namespace idle::cache_file
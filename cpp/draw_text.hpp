@@ -53,9 +53,9 @@ point_t get_text_transform(const fonts::font_t& font, std::string_view str, poin
 
 }  // namespace detail
 
-template <text_align H = text_align::near, text_align V = text_align::near>
+template <text_align H = text_align::near, text_align V = text_align::near, typename Program>
 void draw_text(const fonts::font_t& font,
-        const graphics::text_program_t& prog,
+        const Program& prog,
         const std::string_view str,
         const point_t p,
         const float size,
@@ -66,6 +66,12 @@ void draw_text(const fonts::font_t& font,
     mat[12] += translate.x;
     mat[13] += translate.y;
     prog.set_view_transform(mat);
+
+    if constexpr(idle_has_method(Program, set_smoothing))
+    {
+        prog.set_smoothing(font.distance_field_smoothing(size));
+    }
+
     font.draw(prog, str, limit);
 }
 
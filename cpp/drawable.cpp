@@ -21,6 +21,8 @@
 #include "gl.hpp"
 #include "drawable.hpp"
 #include "png/png.hpp"
+#include "png/image_queue.hpp"
+#include "png/texture_file.hpp"
 
 namespace idle
 {
@@ -57,7 +59,10 @@ image_t::image_t(image_t&& other) noexcept :
 image_t::~image_t() noexcept
 {
     if (width != 0 || height != 0)
+    {
         gl::DeleteTextures(1, &i);
+        graphics::state::forget_texture();
+    }
 }
 
 GLuint image_t::get_gl_id() const noexcept
@@ -74,30 +79,46 @@ GLuint image_t::release() noexcept
 
 image_t image_t::load_from_assets_immediate(const char * fn, GLint quality) noexcept
 {
-    const png_image_data picture(fn);
-    GLuint texID = 0;
+    const auto upload = [fn, quality](const GLenum format, const GLsizei w, const GLsizei h, const unsigned char * const pixels)
+    {
+        GLuint texID = 0;
+        gl::GenTextures(1, &texID);
+        graphics::state::bind_texture(texID);
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, quality); //gl::NEAREST = no smoothing
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, images::magnification_filter(quality)); //gl::LINEAR = smoothing
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE); // gl::CLAMP_TO_EDGE
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE);
+        gl::TexImage2D(gl::TEXTURE_2D, 0, format, w, h, 0, format, gl::UNSIGNED_BYTE, pixels);
+
+        if (images::is_mipmapped(quality))
+            gl::GenerateMipmap(gl::TEXTURE_2D);
+
+        if (graphics::assert_opengl_errors())
+        {
+            LOGE("Texture creation error: %s", fn);
+            std::abort();
+        }
+        graphics::state::bind_texture(0);
+        return texID;
+    };
 
-    if (!picture.image)
+    // The pack leaves out PNGs that have a converted sibling
+    if (const auto converted = images::texture_file::open(fn, !images::npot_supported()))
     {
-        LOGE("Failed to load '%s'", fn);
-        return {};
+        const auto texID = upload(converted->channels > 3 ? gl::RGBA : gl::RGB,
+                converted->stored_width, converted->stored_height, converted->pixels);
+        return { texID, converted->width, converted->height, converted->stored_width, converted->stored_height };
     }
 
-    gl::GenTextures(1, &texID);
-    gl::BindTexture(gl::TEXTURE_2D, texID);
-    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, quality); //gl::NEAREST = no smoothing
-    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, quality != gl::NEAREST ? gl::LINEAR : gl::NEAREST); //gl::LINEAR = smoothing
-    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE); // gl::CLAMP_TO_EDGE
-    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE);
-    gl::TexImage2D(gl::TEXTURE_2D, 0, picture.size > 3 ? gl::RGBA : gl::RGB, picture.real_width, picture.real_height, 0, picture.size > 3 ? gl::RGBA : gl::RGB, gl::UNSIGNED_BYTE, picture.image.get());
+    const png_image_data picture(fn, !images::npot_supported());
 
-    if (graphics::assert_opengl_errors())
+    if (!picture.image)
     {
-        LOGE("Texture creation error: %s", fn);
-        std::abort();
+        LOGE("Failed to load '%s'", fn);
+        return {};
     }
-    gl::BindTexture(gl::TEXTURE_2D, 0);
 
+    const auto texID = upload(picture.size > 3 ? gl::RGBA : gl::RGB, picture.real_width, picture.real_height, picture.image.get());
     return { texID, picture.width, picture.height, picture.real_width, picture.real_height };
 }
 
@@ -161,7 +182,7 @@ void draw_rectangle(const graphics::program_t& prog, const rect_t &rect) noexcep
 void fill_screen(const graphics::core& gl, const graphics::program_t& prog) noexcept
 {
     prog.position_vertex(gl.draw_bounds_verts.data());
-    gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
+    prog.draw_arrays(gl::TRIANGLE_STRIP, 0, 4);
 }
 
 void fill_rectangle(const graphics::program_t& prog, point_t rect) noexcept
@@ -227,8 +248,7 @@ void image_t::draw(const graphics::textured_program_t& prog) const noexcept
             0, tex.y, tex.x, tex.y
     };
 
-    gl::ActiveTexture(gl::TEXTURE0);
-    gl::BindTexture(gl::TEXTURE_2D, i);
+    graphics::state::bind_texture(i);
     prog.position_vertex(v);
     prog.texture_vertex(t);
     gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
@@ -246,8 +266,7 @@ void image_t::draw(const graphics::textured_program_t& prog, point_t p) const no
             0, 0,   tex.x, 0,
             0, tex.y, tex.x, tex.y
     };
-    gl::ActiveTexture(gl::TEXTURE0);
-    gl::BindTexture(gl::TEXTURE_2D, i);
+    graphics::state::bind_texture(i);
     prog.position_vertex(v);
     prog.texture_vertex(t);
     gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
@@ -266,8 +285,7 @@ void image_t::draw(const graphics::textured_program_t& prog, point_t p, const re
             rect.left * tx, rect.top * ty,  rect.right * tx, rect.top * ty,
             rect.left * tx, rect.bottom * ty, rect.right * tx, rect.bottom * ty
     };
-    gl::ActiveTexture(gl::TEXTURE0);
-    gl::BindTexture(gl::TEXTURE_2D, i);
+    graphics::state::bind_texture(i);
     prog.position_vertex(v);
     prog.texture_vertex(t);
     gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
@@ -286,8 +304,7 @@ void image_t::draw(const graphics::textured_program_t& prog, const rect_t &rect)
             rect.left * tx, rect.top * ty,  rect.right * tx, rect.top * ty,
             rect.left * tx, rect.bottom * ty, rect.right * tx, rect.bottom * ty
     };
-    gl::ActiveTexture(gl::TEXTURE0);
-    gl::BindTexture(gl::TEXTURE_2D, i);
+    graphics::state::bind_texture(i);
     prog.position_vertex(v);
     prog.texture_vertex(t);
     gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
@@ -0,0 +1,183 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <log.hpp>
+#include "platform/asset_access.hpp"
+#include "cache_file.hpp"
+#include "font_cache.hpp"
+
+namespace fonts
+{
+
+namespace
+{
+
+constexpr char file_magic[4] { 'I', 'F', 'P', 'C' };
+constexpr std::uint32_t file_version = 1;
+
+struct file_header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t side, cell, count, stored;
+};
+
+struct glyph_record
+{
+    std::uint32_t index, code;
+    float offset_x, offset_y, width;
+};
+
+namespace cache_file = idle::cache_file;
+
+using cache_file::unique_file;
+using cache_file::hash_offset;
+using cache_file::hash;
+
+template<typename T>
+std::uint64_t hash_value(const std::uint64_t h, const T& value) noexcept
+{
+    return hash(h, { reinterpret_cast<const char*>(&value), sizeof(value) });
+}
+
+// Function addresses change between runs, so the filter is keyed by what it lets through
+std::uint64_t hash_filter(std::uint64_t h, bool (* filter_function)(unsigned long)) noexcept
+{
+    std::uint64_t bits = 0;
+    for (unsigned long c = 0; c < 0x10000; ++c)
+    {
+        bits = bits << 1 | filter_function(c);
+        if (c % 64 == 63)
+            h = hash_value(h, bits);
+    }
+    return h;
+}
+
+}  // namespace
+
+page_cache::page_cache(const std::string_view name, const rasterizer& raster, bool (* filter_function)(unsigned long), const std::vector<unsigned long>& codes, const unsigned page_side) noexcept
+    : side(page_side), cell(raster.cell_size())
+{
+    path = platform::cache_path(name);
+
+    if (path.empty())
+        return;
+
+    key = hash(hash_offset, raster.source());
+    key = hash_filter(key, filter_function);
+    key = hash_value(key, side);
+    key = hash_value(key, cell);
+    key = hash_value(key, raster.spread());
+    key = hash(key, { reinterpret_cast<const char*>(codes.data()), codes.size() * sizeof(unsigned long) });
+}
+
+std::optional<prerendered_page> page_cache::load() const noexcept
+{
+    if (path.empty())
+        return {};
+
+    const unique_file f{ std::fopen(path.c_str(), "rb") };
+
+    if (!f)
+        return {};
+
+    file_header header;
+
+    if (std::fread(&header, sizeof(header), 1, f.get()) != 1
+            || std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0
+            || header.version != file_version)
+    {
+        LOGW("Glyph page cache \"%s\" is unreadable", path.c_str());
+        return {};
+    }
+
+    if (header.key != key || header.side != side || header.cell != cell)
+    {
+        LOGI("Glyph page cache \"%s\" is stale", path.c_str());
+        return {};
+    }
+
+    const unsigned cell_count = (side / cell) * (side / cell);
+    if (header.count > cell_count || header.stored > header.count)
+        return {};
+
+    prerendered_page out;
+    out.glyphs.resize(header.count);
+
+    for (std::uint32_t i = 0; i < header.stored; ++i)
+    {
+        glyph_record r;
+
+        if (std::fread(&r, sizeof(r), 1, f.get()) != 1 || r.index >= header.count)
+            return {};
+
+        out.glyphs[r.index] = std::make_pair(static_cast<unsigned long>(r.code), glyph_metrics{ { r.offset_x, r.offset_y }, r.width });
+    }
+
+    const size_t pixel_count = size_t{ side } * side;
+    out.pixels = std::make_unique<unsigned char[]>(pixel_count);
+
+    if (std::fread(out.pixels.get(), 1, pixel_count, f.get()) != pixel_count)
+        return {};
+
+    LOGD("Loaded %u prerendered glyphs from \"%s\"", header.stored, path.c_str());
+    return out;
+}
+
+void page_cache::store(const prerendered_page& page) const noexcept
+{
+    if (path.empty() || !page.pixels)
+        return;
+
+    cache_file::replace(path, [this, &page](FILE* const f)
+        {
+            file_header header{};
+            std::memcpy(header.magic, file_magic, sizeof(file_magic));
+            header.version = file_version;
+            header.key = key;
+            header.side = side;
+            header.cell = cell;
+            header.count = static_cast<std::uint32_t>(page.glyphs.size());
+            header.stored = static_cast<std::uint32_t>(std::count_if(page.glyphs.begin(), page.glyphs.end(),
+                        [](const auto& g) { return g.has_value(); }));
+
+            if (std::fwrite(&header, sizeof(header), 1, f) != 1)
+                return false;
+
+            for (std::uint32_t i = 0; i < header.count; ++i)
+            {
+                if (const auto& g = page.glyphs[i])
+                {
+                    const glyph_record r{ i, static_cast<std::uint32_t>(g->first), g->second.offset.x, g->second.offset.y, g->second.width };
+                    if (std::fwrite(&r, sizeof(r), 1, f) != 1)
+                        return false;
+                }
+            }
+
+            const size_t pixel_count = size_t{ side } * side;
+            return std::fwrite(page.pixels.get(), 1, pixel_count, f) == pixel_count;
+        });
+}
+
+}  // namespace fonts
@@ -0,0 +1,47 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "freetype/glue.hpp"
+
+namespace fonts
+{
+
+// A prerendered glyph page kept from an earlier run, keyed by the font file, the charset filter,
+// the cell size and the prerendered codes; any change there makes the file stale
+class page_cache
+{
+    std::string path;
+    std::uint64_t key = 0;
+    unsigned side, cell;
+
+public:
+    page_cache(std::string_view name, const rasterizer& raster, bool (* filter_function)(unsigned long), const std::vector<unsigned long>& codes, unsigned page_side) noexcept;
+
+    std::optional<prerendered_page> load() const noexcept;
+
+    void store(const prerendered_page& page) const noexcept;
+};
+
+}  // namespace fonts
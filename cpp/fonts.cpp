@@ -18,11 +18,13 @@
 */
 
 #include <algorithm>
+#include <cstring>
 
 #include <utf8.hpp>
 #include <log.hpp>
 
 #include "fonts.hpp"
+#include "gl.hpp"
 
 namespace fonts
 {
@@ -30,32 +32,186 @@ namespace fonts
 namespace
 {
 
-void draw_glyph(const glyph_t& g, const graphics::text_program_t& rcp, const float size, const idle::point_t pos) noexcept
+static_assert(sizeof(glyph_vertex) == 8 * sizeof(GLfloat));
+
+inline constexpr unsigned quad_order[6] { 0, 1, 2, 2, 1, 3 };
+
+}  // namespace
+
+glyph_run::glyph_run(graphics::stream_buffer& s) noexcept
+    : stream{ &s }
+{
+}
+
+void glyph_run::clear() noexcept
+{
+    vertices.clear();
+}
+
+void glyph_run::append(const glyph_t& g, const float size, const idle::point_t pos, const idle::color_t& col) noexcept
 {
-    const float tex_coords[8]
+    const auto origin = pos + g.offset;
+
+    for (const auto i : quad_order)
     {
-        g.texture_position.x, g.texture_position.y,
-        g.texture_position.x + size, g.texture_position.y,
-        g.texture_position.x, g.texture_position.y + size,
-        g.texture_position.x + size, g.texture_position.y + size
-    };
+        const idle::point_t corner { idle::square_coordinates[i * 2], idle::square_coordinates[i * 2 + 1] };
+        vertices.push_back({ origin + corner, g.texture_position + corner * size, col });
+    }
+}
+
+void glyph_run::append(const glyph_t& g, const float size, const idle::point_t pos, const idle::color_t& col, const idle::mat4x4_t& transform) noexcept
+{
+    const auto first = vertices.size();
+    append(g, size, pos, col);
 
-    rcp.set_text_offset(pos + g.offset);
-    rcp.texture_vertex(tex_coords);
-    gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
+    for (auto it = vertices.begin() + first; it != vertices.end(); ++it)
+        it->position = transform * it->position;
 }
 
-}  // namespace
+void glyph_run::draw(const graphics::text_program_t& rcp) const noexcept
+{
+    if (vertices.empty()) return;
 
-void font_t::draw(const graphics::text_program_t& rcp, const std::string_view &str, unsigned int limit) const noexcept
+    const auto bytes = vertices.size() * sizeof(glyph_vertex);
+    const auto verts = stream->allocate(static_cast<GLsizeiptr>(bytes));
+    std::memcpy(verts.data, vertices.data(), bytes);
+    stream->flush();
+
+    constexpr auto stride = static_cast<GLsizei>(sizeof(glyph_vertex));
+
+    rcp.position_vertex(verts.offset, stride);
+    rcp.texture_vertex(verts.offset + 2, stride);
+    rcp.color_vertex(verts.offset + 4, stride);
+    rcp.draw_arrays(gl::TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+    graphics::vertex_buffer::unbind();
+}
+
+glyph_cache::glyph_cache(rasterizer r, const unsigned side, prerendered_page page) noexcept
+    : raster(std::move(r))
+    , page_side(side)
+    , columns(std::max(1u, side / raster.cell_size()))
+    , slots(columns * std::max(1u, side / raster.cell_size()))
+    , scratch(std::make_unique<unsigned char[]>(raster.cell_size() * raster.cell_size()))
+    , initial_pixels(std::move(page.pixels))
 {
-    if (limit == 0) return;
+    for (unsigned i = 0; i < page.glyphs.size() && i < slots.size(); ++i)
+    {
+        if (const auto& g = page.glyphs[i])
+            place(i, g->first, g->second);
+    }
+
+    LOGD("Glyph cache page of %upx holds %zu cells, %zu prerendered", page_side, slots.size(), resident.size());
+}
+
+void glyph_cache::place(const unsigned index, const unsigned long code, const glyph_metrics& metrics) noexcept
+{
+    const unsigned cell = raster.cell_size();
+    const unsigned column = index % columns, row = index / columns;
+
+    slots[index] = { code, stamp };
+    resident.insert_or_assign(code, std::pair<glyph_t, unsigned>{
+            glyph_t{
+                metrics.offset,
+                { column * cell / static_cast<float>(page_side),
+                    (row * cell + 1) / static_cast<float>(page_side) },
+                metrics.width },
+            index });
+}
+
+void glyph_cache::begin_use() noexcept
+{
+    ++stamp;
+}
+
+float glyph_cache::cell_size() const noexcept
+{
+    return raster.cell_size() / static_cast<float>(page_side);
+}
+
+std::optional<unsigned> glyph_cache::claim_slot() noexcept
+{
+    const auto oldest = std::min_element(slots.begin(), slots.end(),
+            [](const slot& left, const slot& right) { return left.last_used < right.last_used; });
+
+    if (oldest->last_used == stamp)
+        return {};
+
+    if (oldest->last_used)
+    {
+        LOGDD("Evicting glyph 0x%03lx", oldest->code);
+        resident.erase(oldest->code);
+    }
+
+    return static_cast<unsigned>(oldest - slots.begin());
+}
+
+void glyph_cache::create_page() noexcept
+{
+    GLuint tex;
+    gl::GenTextures(1, &tex);
+    gl::BindTexture(gl::TEXTURE_2D, tex);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::LINEAR);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::LINEAR);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE);
+#ifdef __ANDROID__
+    gl::TexImage2D(gl::TEXTURE_2D, 0, gl::LUMINANCE, page_side, page_side, 0, gl::LUMINANCE, gl::UNSIGNED_BYTE, initial_pixels.get());
+#else
+    gl::TexImage2D(gl::TEXTURE_2D, 0, gl::R8, page_side, page_side, 0, gl::RED, gl::UNSIGNED_BYTE, initial_pixels.get());
+#endif
+    gl::BindTexture(gl::TEXTURE_2D, 0);
+    graphics::state::forget_texture();
+
+    initial_pixels.reset();
+    texture = graphics::unique_texture{ tex };
+}
+
+const glyph_t * glyph_cache::find(const unsigned long code) noexcept
+{
+    if (!texture.get())
+        create_page();
+
+    if (const auto it = resident.find(code); it != resident.end())
+    {
+        slots[it->second.second].last_used = stamp;
+        return &it->second.first;
+    }
+
+    const auto metrics = raster.render(code, scratch.get());
+    if (!metrics)
+        return nullptr;
+
+    const auto index = claim_slot();
+    if (!index)
+    {
+        LOGW("Glyph cache page is full, skipping 0x%03lx", code);
+        return nullptr;
+    }
 
-    gl::ActiveTexture(gl::TEXTURE0);
     gl::BindTexture(gl::TEXTURE_2D, texture.get());
-    rcp.position_vertex(idle::square_coordinates);
 
+    const unsigned cell = raster.cell_size();
+    const unsigned column = *index % columns, row = *index / columns;
+
+#ifdef __ANDROID__
+    gl::TexSubImage2D(gl::TEXTURE_2D, 0, column * cell, row * cell, cell, cell, gl::LUMINANCE, gl::UNSIGNED_BYTE, scratch.get());
+#else
+    gl::TexSubImage2D(gl::TEXTURE_2D, 0, column * cell, row * cell, cell, cell, gl::RED, gl::UNSIGNED_BYTE, scratch.get());
+#endif
+    graphics::state::forget_texture();
+
+    place(*index, code, *metrics);
+    return &resident.find(code)->second.first;
+}
+
+void font_t::draw(const graphics::text_program_t& rcp, const std::string_view &str, unsigned int limit) const noexcept
+{
+    if (limit == 0) return;
+
+    static constexpr idle::color_t white { 1, 1, 1, 1 };
     idle::point_t pos{ 0, - min_y * .889f };
+    run.clear();
+    cache.begin_use();
 
     for (const auto u8c : utf8x::translator<char>{str})
     {
@@ -64,27 +220,27 @@ void font_t::draw(const graphics::text_program_t& rcp, const std::string_view &s
             pos.x = 0;
             pos.y += 1;
         }
-        else if (const auto gi = character_map.find(u8c); gi != character_map.end())
+        else if (const auto gi = cache.find(u8c))
         {
-            draw_glyph(gi->second, rcp, cell_size, pos);
-            pos.x += gi->second.width;
+            run.append(*gi, cache.cell_size(), pos, white);
+            pos.x += gi->width;
         }
 
         if (!--limit) break;
     }
+
+    graphics::state::bind_texture(cache.texture.get());
+    run.draw(rcp);
 }
 
 void font_t::draw_custom_animation(const graphics::text_program_t& rcp, const std::string_view &str, const ::math::color<float> &col, const idle::text_animation_data* anim, const unsigned start, const unsigned end) const noexcept
 {
-    gl::ActiveTexture(gl::TEXTURE0);
-    gl::BindTexture(gl::TEXTURE_2D, texture.get());
-    rcp.position_vertex(idle::square_coordinates);
-
     idle::point_t pos{0, 0};
-
-    rcp.set_color(col);
+    idle::color_t tint { 1, 1, 1, 1 };
     unsigned int i = 0;
     anim += start;
+    run.clear();
+    cache.begin_use();
 
     for (const auto u8c : utf8x::translator<char>{str})
     {
@@ -93,31 +249,33 @@ void font_t::draw_custom_animation(const graphics::text_program_t& rcp, const st
             pos.x = 0;
             pos.y += 1;
         }
-        else if (const auto gi = character_map.find(u8c); gi != character_map.end())
+        else if (const auto gi = cache.find(u8c))
         {
             if (i >= start)
             {
                 if (anim[1].scale < math::tau_4)
-                    rcp.set_color(col, col.a * (1 - math::sqr(std::cos(anim->scale))));
+                    tint.a = 1 - math::sqr(std::cos(anim->scale));
 
                 auto mat = math::matrices::uniform_scale<float>(1 - std::cos(anim->scale) / 2);
                 math::transform::rotate_z(mat, anim->rotation);
-                rcp.set_transform(mat);
 
-                draw_glyph(gi->second, rcp, cell_size, pos);
+                run.append(*gi, cache.cell_size(), pos, tint, mat);
                 ++anim;
             }
             else
             {
-                draw_glyph(gi->second, rcp, cell_size, pos);
+                run.append(*gi, cache.cell_size(), pos, tint);
             }
 
-            pos.x += gi->second.width;
+            pos.x += gi->width;
         }
 
         if (++i > end) break;
     }
-    rcp.set_identity();
+
+    rcp.set_color(col);
+    graphics::state::bind_texture(cache.texture.get());
+    run.draw(rcp);
 }
 
 idle::point_t font_t::get_extent(const std::string_view& str, const float size, unsigned int limit) const noexcept
@@ -129,6 +287,8 @@ idle::point_t font_t::get_extent(const std::string_view& str, const float size,
     if (limit == 0)
         return { 0, 0 };
 
+    cache.begin_use();
+
     for (const auto u8c : utf8x::translator<char>{str})
     {
         if (u8c == '\n')
@@ -139,8 +299,8 @@ idle::point_t font_t::get_extent(const std::string_view& str, const float size,
 
             current_line_width = 0;
         }
-        else if (const auto gi = character_map.find(u8c); gi != character_map.cend())
-                current_line_width += gi->second.width * size;
+        else if (const auto gi = cache.find(u8c))
+                current_line_width += gi->width * size;
 
         if (!--limit) break;
     }
@@ -149,12 +309,22 @@ idle::point_t font_t::get_extent(const std::string_view& str, const float size,
 }
 
 
+float font_t::distance_field_smoothing(const float size) const noexcept
+{
+    if (spread <= 0 || size <= 0)
+        return .1f;
+
+    // Half a pixel, with a cell being size pixels and the field changing by 0.5 over the spread
+    return std::clamp(.25f / (size * spread), .01f, .25f);
+}
+
 std::string font_t::prepare_string(const std::string_view &str, const float size, const float width) const noexcept
 {
     static constexpr char space = ' ';
     float current_line_width = 0;
     size_t last_space = 0, write_pos = 0;
     std::string out;
+    cache.begin_use();
 
     for (utf8x::translator<char> ut(str); !ut.is_at_end(); ++ut)
     {
@@ -167,7 +337,7 @@ std::string font_t::prepare_string(const std::string_view &str, const float size
                 out += '\n';
             }
         }
-        else if (const auto gi = character_map.find(u8c); gi != character_map.end())
+        else if (const auto gi = cache.find(u8c))
             {
                 if(u8c == space)
                 {
@@ -178,7 +348,7 @@ std::string font_t::prepare_string(const std::string_view &str, const float size
                         out += space;
                     }
 
-                    if (width < current_line_width + gi->second.width * size)
+                    if (width < current_line_width + gi->width * size)
                     {
                         if (out[last_space] == space)
                         {
@@ -204,7 +374,7 @@ std::string font_t::prepare_string(const std::string_view &str, const float size
                     }
                     write_pos += clen;
                 }
-                current_line_width += gi->second.width * size;
+                current_line_width += gi->width * size;
             }
     }
 
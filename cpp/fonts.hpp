@@ -18,15 +18,87 @@
 */
 
 #pragma once
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <math.hpp>
-#include "freetype/glyph.hpp"
+#include "freetype/glue.hpp"
 #include "gl_programs.hpp"
 
+namespace graphics
+{
+class stream_buffer;
+}  // namespace graphics
+
 namespace fonts
 {
 
+struct glyph_vertex
+{
+    idle::point_t position, texture;
+    idle::color_t color;
+};
+
+// Collects a string's glyph quads into one interleaved array, so that it can be drawn in a single call
+class glyph_run
+{
+    std::vector<glyph_vertex> vertices;
+    graphics::stream_buffer* stream;
+
+public:
+    explicit glyph_run(graphics::stream_buffer& s) noexcept;
+
+    void clear() noexcept;
+
+    void append(const glyph_t& g, float cell_size, idle::point_t pos, const idle::color_t& col) noexcept;
+
+    void append(const glyph_t& g, float cell_size, idle::point_t pos, const idle::color_t& col, const idle::mat4x4_t& transform) noexcept;
+
+    void draw(const graphics::text_program_t& rcp) const noexcept;
+};
+
+// Holds the glyphs drawn so far in one texture page of square cells; a glyph is rasterized
+// when first asked for and the least recently used cell is reused once the page is full.
+// Only used from the GL thread
+class glyph_cache
+{
+    struct slot
+    {
+        unsigned long code = 0;
+        unsigned last_used = 0;
+    };
+
+    rasterizer raster;
+    unsigned page_side, columns;
+    std::vector<slot> slots;
+    std::unordered_map<unsigned long, std::pair<glyph_t, unsigned>> resident;
+    std::unique_ptr<unsigned char[]> scratch;
+    std::unique_ptr<unsigned char[]> initial_pixels;
+    unsigned stamp = 1;
+
+    std::optional<unsigned> claim_slot() noexcept;
+
+    void place(unsigned index, unsigned long code, const glyph_metrics& metrics) noexcept;
+
+    void create_page() noexcept;
+
+public:
+    graphics::unique_texture texture{ 0 };
+
+    // The page starts out with the prerendered glyphs, uploaded along with the texture
+    glyph_cache(rasterizer r, unsigned side, prerendered_page page) noexcept;
+
+    // Glyphs found since the last call are safe from eviction until the next one
+    void begin_use() noexcept;
+
+    const glyph_t * find(unsigned long code) noexcept;
+
+    float cell_size() const noexcept;
+};
+
 struct font_t
 {
     void draw(const graphics::text_program_t& rcp, const std::string_view &str, unsigned int limit = (-1)) const noexcept;
@@ -38,21 +110,25 @@ struct font_t
 
     std::string prepare_string(const std::string_view &str, float font_size, float max_width) const noexcept;
 
+    // Edge smoothing for the distance field program when drawn at the given size in pixels
+    float distance_field_smoothing(float font_size) const noexcept;
+
 #ifndef IDLE_COMPILE_FONT_DEBUG_SCREEN
 private:
 #endif
-    graphics::unique_texture texture;
-    glyph_map_t character_map;
-    float cell_size, min_y, max_y;
+    float min_y, max_y;
+    float spread;  // in cells, zero unless the glyphs are distance fields
+    mutable glyph_cache cache;
+    mutable glyph_run run;
 
 public:
-    template<typename A, typename B>
-    font_t(A&& tex, B&& map, const float size, const float mny, const float mxy) noexcept
-        : texture(std::forward<A>(tex))
-        , character_map(std::forward<B>(map))
-        , cell_size(size)
-        , min_y(mny)
-        , max_y(mxy)
+    // The stream belongs to the same core as the font and outlives it
+    font_t(rasterizer raster, const unsigned page_side, prerendered_page page, graphics::stream_buffer& stream) noexcept
+        : min_y(raster.top())
+        , max_y(raster.bottom())
+        , spread(raster.spread() / static_cast<float>(raster.cell_size()))
+        , cache(std::move(raster), page_side, std::move(page))
+        , run(stream)
     {
     }
 };
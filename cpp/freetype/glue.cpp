@@ -17,9 +17,11 @@
     along with Idle. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <memory>
-#include <vector>
+#include <thread>
 
 #include <ft2build.h>
 #include <freetype/freetype.h>
@@ -36,7 +38,6 @@ namespace fonts
 
 namespace
 {
-using font_face_t = std::unique_ptr<std::remove_pointer_t<FT_Face>, decltype(&FT_Done_Face)>;
 
 struct glyph_view
 {
@@ -87,132 +88,282 @@ struct glyph_view
     }
 };
 
+unsigned count_chars(const FT_Face face, bool (* filter_function)(unsigned long)) noexcept
+{
+    unsigned out = 0;
+    for (const auto it : glyph_view{ face })
+    {
+        if (filter_function(it.code))
+            ++out;
+    }
+    return out;
+}
 
+constexpr unsigned distance_field_cell = 40, distance_field_spread = 6;
 
-std::optional<ft_data_t> create_font(const font_face_t freetype_font_face, const unsigned resolution, bool (* filter_function)(unsigned long)) noexcept
+// Looks for the nearest pixel on the other side of the edge within the spread, which is small enough for brute force;
+// partially covered pixels sit right on the edge and their coverage gives the distance there
+void coverage_to_distance(unsigned char * const pixels, const unsigned size, const unsigned spread) noexcept
 {
-    const auto filtered_chars = [&filter_function, ft = freetype_font_face.get()]()
+    const auto coverage = std::make_unique<unsigned char[]>(size * size);
+    ::memcpy(coverage.get(), pixels, size * size);
+
+    const auto inside = [&coverage, size](const int x, const int y) noexcept
     {
-        std::vector<glyph_view::position> out;
-        for (const auto it : glyph_view{ ft })
+        return x >= 0 && y >= 0 && x < static_cast<int>(size) && y < static_cast<int>(size)
+            && coverage[static_cast<unsigned>(y) * size + static_cast<unsigned>(x)] >= 128;
+    };
+
+    const int reach = static_cast<int>(spread);
+
+    for (int y = 0; y < static_cast<int>(size); ++y)
+        for (int x = 0; x < static_cast<int>(size); ++x)
         {
-            if (filter_function(it.code))
-                out.push_back(it);
+            const bool in = inside(x, y);
+            int nearest = (reach + 1) * (reach + 1);
+
+            for (int dy = -reach; dy <= reach; ++dy)
+                for (int dx = -reach; dx <= reach; ++dx)
+                {
+                    if (dx * dx + dy * dy < nearest && inside(x + dx, y + dy) != in)
+                        nearest = dx * dx + dy * dy;
+                }
+
+            const float distance = std::sqrt(static_cast<float>(nearest)) - .5f;
+            float signed_distance = in ? distance : -distance;
+
+            if (const auto c = coverage[static_cast<unsigned>(y) * size + static_cast<unsigned>(x)]; c > 0 && c < 255)
+            {
+                const float edge = c / 255.f - .5f;
+                if (std::abs(edge) < std::abs(signed_distance))
+                    signed_distance = edge;
+            }
+
+            const float value = std::clamp(.5f + signed_distance / static_cast<float>(2 * spread), 0.f, 1.f);
+            pixels[static_cast<unsigned>(y) * size + static_cast<unsigned>(x)] = static_cast<unsigned char>(value * 255.f + .5f);
         }
-        return out;
-    }();
+}
+
+}  // namespace
+
+struct rasterizer::face_state
+{
+    FT_Library library = nullptr;
+    FT_Face face = nullptr;
+    std::string_view memory;
+    std::shared_ptr<const void> storage;
+};
+
+void rasterizer::face_release::operator()(face_state * const st) const noexcept
+{
+    if (st->face)
+        FT_Done_Face(st->face);
+
+    if (st->library)
+        FT_Done_FreeType(st->library);
+
+    delete st;
+}
+
+rasterizer::rasterizer(std::unique_ptr<face_state, face_release> st, bool (* filter_function)(unsigned long), const unsigned cell_size, const unsigned cell_margin, const glyph_style gs) noexcept
+    : state(std::move(st))
+    , filter(filter_function)
+    , cell(cell_size)
+    , margin(cell_margin)
+    , style(gs)
+{
+    const auto& metrics = state->face->size->metrics;
+    ascent = -metrics.ascender / static_cast<float>(64 * cell);
+    descent = -metrics.descender / static_cast<float>(64 * cell);
+}
+
+rasterizer::rasterizer(rasterizer&&) noexcept = default;
+
+rasterizer& rasterizer::operator=(rasterizer&&) noexcept = default;
+
+rasterizer::~rasterizer() noexcept = default;
+
+std::unique_ptr<rasterizer::face_state, rasterizer::face_release> rasterizer::open_face(const std::string_view memory, std::shared_ptr<const void> storage) noexcept
+{
+    std::unique_ptr<face_state, face_release> st{ new face_state };
+    st->memory = memory;
+    st->storage = std::move(storage);
+
+    // Every face gets a library of its own, which lets them render on different threads
+    if (!!FT_Init_FreeType(&st->library))
+    {
+        st->library = nullptr;
+        LOGE("Failed to initialize freetype library");
+        return {};
+    }
+
+    if (!!FT_New_Memory_Face(
+                st->library,
+                reinterpret_cast<const FT_Byte *>(memory.data()),
+                static_cast<FT_Long>(memory.size()), 0, &st->face))
+    {
+        st->face = nullptr;
+        LOGE("Error loading font face");
+        return {};
+    }
+
+    return st;
+}
+
+std::optional<rasterizer> rasterizer::open(bool (* filter_function)(unsigned long), const std::string_view memory, std::shared_ptr<const void> storage, const texture_quality quality, const glyph_style gs) noexcept
+{
+    auto st = open_face(memory, std::move(storage));
+    if (!st)
+        return {};
+
+    if (gs == glyph_style::distance_field)
+    {
+        LOGD("Distance field glyphs in %upx cells", distance_field_cell);
+        FT_Set_Pixel_Sizes(st->face, distance_field_cell - distance_field_spread * 2, distance_field_cell - distance_field_spread * 2);
+        return { rasterizer{ std::move(st), filter_function, distance_field_cell, distance_field_spread, gs } };
+    }
 
-    const unsigned character_row_width = static_cast<unsigned>(std::ceil(std::sqrt(filtered_chars.size())));
+    const unsigned resolution = static_cast<unsigned>(quality);
+    const unsigned char_count = std::max(1u, count_chars(st->face, filter_function));
+    const unsigned character_row_width = static_cast<unsigned>(std::ceil(std::sqrt(char_count)));
     const unsigned cell_size = resolution / character_row_width;
     const unsigned cell_margin = std::max(2u, cell_size / 13);
     const unsigned glyph_apparent_height = cell_size - cell_margin * 2;
 
-    LOGD("Given %zu chars and %upx resolution, calculated %u columns of %upx cells (%upx w/o margins)",
-            filtered_chars.size(),
+    LOGD("Given %u chars and %upx resolution, calculated %upx cells (%upx w/o margins)",
+            char_count,
             resolution,
-            character_row_width,
             cell_size,
             glyph_apparent_height);
 
-    FT_Set_Pixel_Sizes(freetype_font_face.get(), glyph_apparent_height, glyph_apparent_height);
+    FT_Set_Pixel_Sizes(st->face, glyph_apparent_height, glyph_apparent_height);
 
-    auto texture_data = std::make_unique<unsigned char[]>(resolution * resolution);
-    ::memset(texture_data.get(), 0, resolution * resolution);
-
-    glyph_map_t glyphs;
-
-    math::point2<unsigned int> texture_position{0, 0};
+    return { rasterizer{ std::move(st), filter_function, cell_size, cell_margin, gs } };
+}
 
-    for (const auto [gindex, charcode] : filtered_chars)
-    {
-        if (!!FT_Load_Glyph(freetype_font_face.get(), gindex, FT_LOAD_DEFAULT))
-        {
-            LOGW("Failed to load glyph 0x%03lx", charcode);
-            continue;
-        }
+std::optional<rasterizer> rasterizer::clone() const noexcept
+{
+    auto st = open_face(state->memory, state->storage);
+    if (!st)
+        return {};
 
-        FT_GlyphSlot glyph = freetype_font_face->glyph;
-        FT_Render_Glyph(glyph, FT_RENDER_MODE_NORMAL);
+    const unsigned glyph_apparent_height = cell - margin * 2;
+    FT_Set_Pixel_Sizes(st->face, glyph_apparent_height, glyph_apparent_height);
 
-        glyphs.emplace(charcode, glyph_t{
-            { glyph->bitmap_left / static_cast<float>(cell_size),
-                - glyph->bitmap_top / static_cast<float>(cell_size) },
+    return { rasterizer{ std::move(st), filter, cell, margin, style } };
+}
 
-            { texture_position.x * cell_size / static_cast<float>(resolution),
-                (texture_position.y * cell_size + 1) / static_cast<float>(resolution) },
+prerendered_page rasterizer::render_page(const std::vector<unsigned long>& codes, const unsigned side, const unsigned thread_count) noexcept
+{
+    const unsigned columns = std::max(1u, side / cell);
+    const size_t cell_count = std::min<size_t>(codes.size(), size_t{ columns } * std::max(1u, side / cell));
 
-            glyph->advance.x / static_cast<float>(64 * cell_size)});
+    prerendered_page out;
+    out.pixels = std::make_unique<unsigned char[]>(size_t{ side } * side);
+    ::memset(out.pixels.get(), 0, size_t{ side } * side);
+    out.glyphs.resize(cell_count);
 
-        const unsigned base_offset = cell_size * (texture_position.x + texture_position.y * resolution);
-        const unsigned gr = glyph->bitmap.rows;
-        const unsigned gw = glyph->bitmap.width;
-        unsigned char * const data_ptr = texture_data.get() + base_offset + cell_margin * (resolution + 1);
+    // Worker k takes every k-th cell, so nothing they write overlaps
+    const auto work = [&](rasterizer& raster, const unsigned first, const unsigned step)
+    {
+        auto scratch = std::make_unique<unsigned char[]>(cell * cell);
 
-        for (unsigned y = 0; y < gr; ++y)
-            for (unsigned x = 0; x < gw; ++x)
+        for (size_t i = first; i < cell_count; i += step)
+        {
+            if (const auto metrics = raster.render(codes[i], scratch.get()))
             {
-                data_ptr[resolution * y + x] = glyph->bitmap.buffer[x + y * gw];
-            }
+                unsigned char * const corner = out.pixels.get() + size_t{ side } * (i / columns) * cell + (i % columns) * cell;
+                for (unsigned y = 0; y < cell; ++y)
+                    ::memcpy(corner + size_t{ side } * y, scratch.get() + cell * y, cell);
 
-        if (++texture_position.x >= character_row_width)
-        {
-            texture_position.x = 0;
-            ++texture_position.y;
+                out.glyphs[i] = std::make_pair(codes[i], *metrics);
+            }
         }
+    };
+
+    std::vector<rasterizer> helpers;
+    for (unsigned i = 1; i < std::min<size_t>(thread_count, cell_count); ++i)
+    {
+        if (auto other = clone())
+            helpers.push_back(std::move(*other));
     }
 
-    return {{
-        std::move(texture_data),
-        static_cast<unsigned>(resolution),
-        std::move(glyphs),
-        cell_size / (float)resolution
-    }};
-}
+    const unsigned step = static_cast<unsigned>(helpers.size()) + 1;
+    std::vector<std::thread> threads;
+    threads.reserve(helpers.size());
 
-constinit FT_Library library;
-constinit unsigned library_ref_count = 0;
-constinit bool library_loaded = false;
+    for (unsigned i = 0; i < helpers.size(); ++i)
+        threads.emplace_back([&work, &raster = helpers[i], first = i + 1, step] { work(raster, first, step); });
 
-}  // namespace
+    work(*this, 0, step);
 
+    for (auto& t : threads)
+        t.join();
 
-std::optional<ft_data_t> freetype_glue::operator()(bool (* filter_function)(unsigned long), const std::string_view &memory, const texture_quality resolution) const noexcept
-{
-    if (!library_loaded) return {};
+    LOGD("Prerendered %zu glyphs on %u threads", cell_count, step);
+    return out;
+}
 
-    if (FT_Face ff = nullptr;
-            !FT_New_Memory_Face(
-                library,
-                reinterpret_cast<const FT_Byte *>(memory.data()),
-                static_cast<FT_Long>(memory.size()), 0, &ff))
-    {
-        return create_font({ ff, FT_Done_Face }, static_cast<unsigned>(resolution), filter_function);
-    }
+unsigned rasterizer::cell_size() const noexcept
+{
+    return cell;
+}
 
-    LOGE("Error loading font face");
-    return {};
+unsigned rasterizer::spread() const noexcept
+{
+    return style == glyph_style::distance_field ? margin : 0;
 }
 
+std::string_view rasterizer::source() const noexcept
+{
+    return state->memory;
+}
 
-freetype_glue::freetype_glue() noexcept
+float rasterizer::top() const noexcept
 {
-    if (++library_ref_count == 1)
-    {
-        library_loaded = FT_Init_FreeType(&library) == 0;
+    return ascent;
+}
 
-        if (!library_loaded)
-        {
-            LOGE("Failed to initialize freetype library");
-        }
-    }
+float rasterizer::bottom() const noexcept
+{
+    return descent;
 }
 
-freetype_glue::~freetype_glue() noexcept
+std::optional<glyph_metrics> rasterizer::render(const unsigned long code, unsigned char * const cell_pixels) noexcept
 {
-    if (--library_ref_count == 0)
+    const FT_Face face = state->face;
+    const FT_UInt gindex = filter(code) ? FT_Get_Char_Index(face, code) : 0;
+
+    if (!gindex)
+        return {};
+
+    if (!!FT_Load_Glyph(face, gindex, FT_LOAD_DEFAULT))
     {
-        FT_Done_FreeType(library);
+        LOGW("Failed to load glyph 0x%03lx", code);
+        return {};
     }
+
+    FT_GlyphSlot glyph = face->glyph;
+    FT_Render_Glyph(glyph, FT_RENDER_MODE_NORMAL);
+
+    ::memset(cell_pixels, 0, cell * cell);
+
+    const unsigned gr = std::min(glyph->bitmap.rows, cell - margin);
+    const unsigned gw = std::min(glyph->bitmap.width, cell - margin);
+    const unsigned pitch = static_cast<unsigned>(std::abs(glyph->bitmap.pitch));
+    unsigned char * const data_ptr = cell_pixels + margin * (cell + 1);
+
+    for (unsigned y = 0; y < gr; ++y)
+        ::memcpy(data_ptr + cell * y, glyph->bitmap.buffer + pitch * y, gw);
+
+    if (style == glyph_style::distance_field)
+        coverage_to_distance(cell_pixels, cell, margin);
+
+    return {{
+        { glyph->bitmap_left / static_cast<float>(cell),
+            - glyph->bitmap_top / static_cast<float>(cell) },
+        glyph->advance.x / static_cast<float>(64 * cell)
+    }};
 }
 
 }  // namespace fonts
@@ -18,8 +18,11 @@
 */
 #pragma once
 
-#include <string_view>
+#include <memory>
 #include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include "glyph.hpp"
 
 namespace fonts
@@ -32,15 +35,74 @@ enum class texture_quality : unsigned
     ludicrous = 2 << 12
 };
 
-struct freetype_glue
+enum class glyph_style : unsigned
+{
+    coverage,
+
+    // Signed distance to the outline, 0.5 on the edge and spreading over the cell margin
+    distance_field
+};
+
+// Cell i of a page sits at (i % columns, i / columns), cells the face could not render stay empty
+struct prerendered_page
 {
-    std::optional<ft_data_t> operator()(bool (* filter_function)(unsigned long), const std::string_view &memory, texture_quality resolution) const noexcept;
+    std::unique_ptr<unsigned char[]> pixels;
+    std::vector<std::optional<std::pair<unsigned long, glyph_metrics>>> glyphs;
+};
+
+// Keeps a face open and renders single glyphs into square cells on request;
+// coverage cells are sized as if the whole filtered charset shared one texture of the given resolution,
+// distance field cells are small and fixed since they scale well
+class rasterizer
+{
+    struct face_state;
+
+    struct face_release
+    {
+        void operator()(face_state *) const noexcept;
+    };
+
+    std::unique_ptr<face_state, face_release> state;
+    bool (* filter)(unsigned long);
+    unsigned cell, margin;
+    float ascent, descent;
+    glyph_style style;
+
+    rasterizer(std::unique_ptr<face_state, face_release> st, bool (* filter_function)(unsigned long), unsigned cell_size, unsigned cell_margin, glyph_style gs) noexcept;
+
+    static std::unique_ptr<face_state, face_release> open_face(std::string_view memory, std::shared_ptr<const void> storage) noexcept;
+
+public:
+    // The face reads straight from memory, so storage has to keep it alive
+    static std::optional<rasterizer> open(bool (* filter_function)(unsigned long), std::string_view memory, std::shared_ptr<const void> storage, texture_quality resolution, glyph_style gs = glyph_style::coverage) noexcept;
+
+    rasterizer(rasterizer&&) noexcept;
+
+    rasterizer& operator=(rasterizer&&) noexcept;
+
+    ~rasterizer() noexcept;
+
+    unsigned cell_size() const noexcept;
+
+    // How far the distance field reaches on either side of the edge in pixels, zero for coverage
+    unsigned spread() const noexcept;
+
+    // The font file the face reads from
+    std::string_view source() const noexcept;
+
+    // Highest and lowest point of the face relative to the baseline, in cells and with y going down
+    float top() const noexcept;
+
+    float bottom() const noexcept;
+
+    // Fills a cell_size * cell_size buffer, empty when the filter or the face lacks the character
+    std::optional<glyph_metrics> render(unsigned long code, unsigned char * cell) noexcept;
 
-    freetype_glue() noexcept;
-    ~freetype_glue() noexcept;
+    // Another face over the same memory and at the same size, for rendering on another thread
+    std::optional<rasterizer> clone() const noexcept;
 
-    freetype_glue(const freetype_glue &) = delete;
-    freetype_glue(freetype_glue &&) = delete;
+    // Renders the codes into the first cells of a side * side page, spread over thread_count faces
+    prerendered_page render_page(const std::vector<unsigned long>& codes, unsigned side, unsigned thread_count) noexcept;
 };
 
-}
+}  // namespace fonts
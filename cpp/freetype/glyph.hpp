@@ -31,14 +31,11 @@ struct glyph_t
     float width;
 };
 
-using glyph_map_t = std::unordered_map<unsigned long, glyph_t>;
-
-struct ft_data_t
+// Placement of a freshly rendered glyph, in cells
+struct glyph_metrics
 {
-    std::unique_ptr<unsigned char[]> pixels;
-    unsigned width;
-    glyph_map_t map;
-    float cell_size;
+    math::point2<float> offset;
+    float width;
 };
 
 }  // namespace fonts
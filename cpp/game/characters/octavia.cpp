@@ -18,6 +18,8 @@
 */
 
 #include <cmath>
+#include <type_traits>
+#include <idle/glass/baked.hpp>
 #include "octavia.hpp"
 
 namespace idle::crimson::characters
@@ -37,16 +39,61 @@ inline constexpr auto octa_ani<traits::humanoid::animation::walk> = glass::make<
 
 inline constexpr auto human_skin = glass::paint::human_mesh.texture();
 
-void draw_octavia(const graphics::double_vertex_program_t& prog, const traits::humanoid::frame& fr) noexcept
+using octavia_keyframes = glass::baked_keyframes<std::remove_const_t<decltype(human_skin)>>;
+
+auto& baked_octavia() noexcept
+{
+    static glass::baked_tables baked
+    {
+        octa_ani<traits::humanoid::animation::walk>,
+        human_skin,
+        octavia_keyframes::indices
+    };
+    return baked;
+}
+
+template<auto Enum>
+auto& keyframes_octavia() noexcept
+{
+    static octavia_keyframes keyframes{ octa_ani<Enum>, human_skin };
+    return keyframes;
+}
+
+// Frames drawing their parts in the same order all map to the row of the first of them
+template<auto Enum>
+inline constexpr auto octa_order = []
+{
+    constexpr auto& table = octa_ani<Enum>;
+    constexpr std::size_t count = table.front().size();
+    std::array<std::uint8_t, table.size() * count> out{};
+
+    for (std::size_t i = 0; i < out.size(); ++i)
+        for (std::size_t j = 0; j <= i; ++j)
+            if (table[j / count][j % count].precedence.order() == table[i / count][i % count].precedence.order())
+            {
+                out[i] = static_cast<std::uint8_t>(j);
+                break;
+            }
+    return out;
+}();
+
+template<typename Program>
+void draw_octavia(const Program& prog, const images::texture& tex, const traits::humanoid::frame& fr) noexcept
 {
+    auto& baked = baked_octavia();
+
     prog.set_interpolation(fr.timer);
-    prog.set_texture_shift({ static_cast<uint8_t>(fr.dir) / 8.f, 0 });
+    prog.set_texture_mult(tex.area / 8.f);
+    prog.set_texture_shift(tex.offset + point_t{ static_cast<uint8_t>(fr.dir) / 8.f * tex.area.x, 0 });
     const bool data = true;
 
+    baked.bind();
+    const auto baked_prog = baked.wrap(prog);
+
     const auto animate = [&](const auto& paint)
     {
         paint[fr.sub[0]].draw(
-                prog,
+                baked_prog,
                 paint[fr.sub[1]],
                 human_skin, data);
     };
@@ -63,6 +110,61 @@ void draw_octavia(const graphics::double_vertex_program_t& prog, const traits::h
         default:
             break;
     }
+
+    graphics::vertex_buffer::unbind();
+}
+#undef idle_animation
+
+// Instances bring their own keyframes and direction, the frame in row only decides the order of the parts
+void draw_octavia_crowd(const graphics::instanced_double_program_t& prog, const images::texture& tex,
+        const traits::humanoid::animation anim, const std::size_t row, const GLsizei instances) noexcept
+{
+    auto& baked = baked_octavia();
+
+    prog.set_texture_mult(tex.area / 8.f);
+    prog.set_texture_shift(tex.offset);
+    const bool data = true;
+
+    const auto animate = [&](const auto& table, auto& keyframes)
+    {
+        keyframes.bind(prog.keyframes_unit);
+        prog.set_keyframes_size(keyframes.size());
+        baked.bind();
+
+        const auto& paint = table[row / table.front().size()][row % table.front().size()];
+        paint.draw(keyframes.wrap(prog, baked, instances), paint, human_skin, data);
+    };
+
+    switch (anim)
+    {
+#define idle_animation(x) \
+        case traits::humanoid::animation::x: \
+            animate(octa_ani<traits::humanoid::animation::x>, keyframes_octavia<traits::humanoid::animation::x>()); \
+            break
+
+        idle_animation(walk);
+
+        default:
+            break;
+    }
+
+    graphics::vertex_buffer::unbind();
+}
+#undef idle_animation
+
+std::size_t order_row(const traits::humanoid::frame& fr) noexcept
+{
+    switch (fr.anim)
+    {
+#define idle_animation(x) \
+        case traits::humanoid::animation::x: \
+            return octa_order<traits::humanoid::animation::x>[static_cast<uint8_t>(fr.dir) * octa_ani<traits::humanoid::animation::x>.front().size() + fr.sub[0]]
+
+        idle_animation(walk);
+
+        default:
+            return 0;
+    }
 }
 #undef idle_animation
 
@@ -98,11 +200,34 @@ octavia::octavia() noexcept
 
 void octavia::draw(const graphics::core& gl) const noexcept
 {
-    gl::ActiveTexture(gl::TEXTURE0);
-    gl::BindTexture(gl::TEXTURE_2D, tex.id);
-    gl.prog.double_normal.set_texture_mult(tex.area / 8.f);
+    graphics::state::bind_texture(tex.id);
+
+    draw_octavia(gl.prog.double_normal, tex, fr);
+}
+
+hotel::stage::crowd_member octavia::crowd() const noexcept
+{
+    const auto frame = fr.load();
+    const auto count = anim_length(frame.anim);
+    const auto dir = static_cast<uint8_t>(frame.dir);
+    return
+    {
+        (std::uint64_t{ tex.id } << 32)
+            | (std::uint64_t{ static_cast<uint8_t>(frame.anim) } << 16)
+            | std::uint64_t{ order_row(frame) },
+        frame.timer,
+        { octavia_keyframes::row(dir, frame.sub[0], count), octavia_keyframes::row(dir, frame.sub[1], count) },
+        dir / 8.f * tex.area.x
+    };
+}
+
+void octavia::draw_crowd(const graphics::core& gl, const hotel::stage::crowd_member& member, const GLsizei count) const noexcept
+{
+    graphics::state::bind_texture(tex.id);
 
-    draw_octavia(gl.prog.double_normal, fr);
+    draw_octavia_crowd(gl.prog.double_instanced, tex,
+            static_cast<traits::humanoid::animation>(member.key >> 16 & 0xff),
+            static_cast<std::size_t>(member.key & 0xffff), count);
 }
 
 point_t octavia::apply_physics(const point_t pos) const noexcept
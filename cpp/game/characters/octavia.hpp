@@ -41,6 +41,10 @@ struct octavia : traits::humanoid
     hotel::stage::action step() noexcept;
 
     void draw(const graphics::core& gl) const noexcept;
+
+    hotel::stage::crowd_member crowd() const noexcept;
+
+    void draw_crowd(const graphics::core& gl, const hotel::stage::crowd_member& member, GLsizei count) const noexcept;
 };
 
 
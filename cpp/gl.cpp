@@ -18,9 +18,14 @@
 */
 
 #include <vector>
+#include <algorithm>
+#include <mutex>
+#include <bit>
 #include <zlib.hpp>
 #include <math.hpp>
 #include "gl.hpp"
+#include "program_cache.hpp"
+#include "png/image_queue.hpp"
 #include <cstring>
 #include <embedded_shaders.hpp>
 
@@ -48,37 +53,104 @@ void detailed_report_opengl_errors(const char* op, const char *const file, const
 #define report_opengl_errors(x) ((void)0)
 #endif
 
-GLuint load_shader(const GLenum shaderType, const char* const pSource) noexcept
+GLuint start_shader(const GLenum shaderType, const char* const pSource) noexcept
 {
     if (const GLuint shader = gl::CreateShader(shaderType))
     {
         gl::ShaderSource(shader, 1, &pSource, nullptr);
         gl::CompileShader(shader);
-        GLint compiled = 0;
-        gl::GetShaderiv(shader, gl::COMPILE_STATUS, &compiled);
+        return shader;
+    }
+    return 0;
+}
+
+// Waits for the compiler when it is still busy
+bool shader_compiled(const GLuint shader) noexcept
+{
+    GLint compiled = 0;
+    gl::GetShaderiv(shader, gl::COMPILE_STATUS, &compiled);
+
+    if (!compiled)
+    {
+        GLint infoLen = 0;
+        gl::GetShaderiv(shader, gl::INFO_LOG_LENGTH, &infoLen);
 
-        if (compiled)
+        if (infoLen)
         {
-            return shader;
+            GLint shaderType = 0;
+            gl::GetShaderiv(shader, gl::SHADER_TYPE, &shaderType);
+
+            char buf[infoLen];
+            gl::GetShaderInfoLog(shader, infoLen, nullptr, buf);
+            LOGE("Could not compile shader %d:\n%s", shaderType, buf);
         }
-        else
-        {
-            GLint infoLen = 0;
-            gl::GetShaderiv(shader, gl::INFO_LOG_LENGTH, &infoLen);
+    }
+    return !!compiled;
+}
 
-            if (infoLen)
-            {
-                char buf[infoLen];
-                gl::GetShaderInfoLog(shader, infoLen, nullptr, buf);
-                LOGE("Could not compile shader %d:\n%s", shaderType, buf);
-            }
-            gl::DeleteShader(shader);
+GLuint load_shader(const GLenum shaderType, const char* const pSource) noexcept
+{
+    if (const GLuint shader = start_shader(shaderType, pSource))
+    {
+        if (shader_compiled(shader))
+            return shader;
+
+        gl::DeleteShader(shader);
+    }
+    return 0;
+}
+
+// The link is only issued, its status is left for later
+GLuint start_program(const GLuint vertexShader, const GLuint pixelShader, const bool retrievable) noexcept
+{
+    if (const GLuint program = gl::CreateProgram())
+    {
+        gl::AttachShader(program, vertexShader);
+        gl::AttachShader(program, pixelShader);
+
+        // Pinned so that enabling them per pass cannot disturb the attributes of other programs
+        gl::BindAttribLocation(program, dual_view_program_t<program_t>::view_location, "attr_view");
+        gl::BindAttribLocation(program, dual_view_program_t<program_t>::view_mask_location, "attr_view_mask");
+
+        // Past the eight attributes every context has, contexts able to draw instances have more
+        GLint max_attributes = 0;
+        gl::GetIntegerv(gl::MAX_VERTEX_ATTRIBS, &max_attributes);
+        if (instanced_double_program_t::keyframes_location < static_cast<GLuint>(max_attributes))
+        {
+            gl::BindAttribLocation(program, instanced_double_program_t::instance_location, "attr_instance");
+            gl::BindAttribLocation(program, instanced_double_program_t::keyframes_location, "attr_keyframes");
         }
+
+        if (retrievable && gl::ProgramParameteri)
+            gl::ProgramParameteri(program, gl::PROGRAM_BINARY_RETRIEVABLE_HINT, gl::TRUE_);
+
+        gl::LinkProgram(program);
+        return program;
     }
     return 0;
 }
 
-GLuint create_program(const char* const pVertexSource, const char* const pFragmentSource) noexcept
+bool program_linked(const GLuint program) noexcept
+{
+    GLint linkStatus = gl::FALSE_;
+    gl::GetProgramiv(program, gl::LINK_STATUS, &linkStatus);
+
+    if (linkStatus != gl::TRUE_)
+    {
+        GLint bufLength = 0;
+        gl::GetProgramiv(program, gl::INFO_LOG_LENGTH, &bufLength);
+        if (bufLength)
+        {
+            char buf[bufLength];
+            gl::GetProgramInfoLog(program, bufLength, nullptr, buf);
+            LOGE("Could not link program:\n%s", buf);
+        }
+        return false;
+    }
+    return true;
+}
+
+GLuint create_program(const char* const pVertexSource, const char* const pFragmentSource, const bool retrievable) noexcept
 {
     const GLuint vertexShader = load_shader(gl::VERTEX_SHADER, pVertexSource);
     if (!vertexShader)
@@ -88,28 +160,12 @@ GLuint create_program(const char* const pVertexSource, const char* const pFragme
     if (!pixelShader)
         return 0;
 
-    if (const GLuint program = gl::CreateProgram())
+    if (const GLuint program = start_program(vertexShader, pixelShader, retrievable))
     {
-        gl::AttachShader(program, vertexShader);
-        gl::AttachShader(program, pixelShader);
-        gl::LinkProgram(program);
-        GLint linkStatus = gl::FALSE_;
-        gl::GetProgramiv(program, gl::LINK_STATUS, &linkStatus);
+        if (program_linked(program))
+            return program;
 
-        if (linkStatus != gl::TRUE_)
-        {
-            GLint bufLength = 0;
-            gl::GetProgramiv(program, gl::INFO_LOG_LENGTH, &bufLength);
-            if (bufLength)
-            {
-                char buf[bufLength];
-                gl::GetProgramInfoLog(program, bufLength, nullptr, buf);
-                LOGE("Could not link program:\n%s", buf);
-            }
-            gl::DeleteProgram(program);
-            return 0;
-        }
-        return program;
+        gl::DeleteProgram(program);
     }
     return 0;
 }
@@ -119,12 +175,15 @@ class shader_compiler
 {
     using buffer_type = std::array<char, Size>;
 
-    bool failed;
+    std::string_view source;
+    program_builder& builder;
+    program_cache& cache;
+    bool failed = false, decompressed = false;
     buffer_type buffer;
 
 public:
-    shader_compiler(const std::string_view view) noexcept
-        : failed(!decompress(view))
+    shader_compiler(const std::string_view view, program_builder& b) noexcept
+        : source(view), builder(b), cache(b.cache())
     {
     }
 
@@ -145,21 +204,76 @@ private:
         return false;
     }
 
+    // Sources are only inflated once a program is missing from the cache
+    bool inflate() noexcept
+    {
+        if (!decompressed)
+        {
+            failed = !decompress(source);
+            decompressed = true;
+        }
+        return !failed;
+    }
+
 public:
     GLuint compile(const unsigned int v, const unsigned int f) noexcept
     {
         if (!has_failed())
         {
-            if (const auto r = create_program(data(v), data(f)))
+            if (const auto r = cache.load(v, f))
             {
                 return r;
             }
 
+            if (inflate())
+            {
+                if (const auto r = create_program(data(v), data(f), cache.is_enabled()))
+                {
+                    cache.store(r, v, f);
+                    return r;
+                }
+            }
+
             failed = true;
         }
         return 0;
     }
 
+    // Hands the program over to the builder without waiting for the driver
+    template<typename Program>
+    void start(Program& program, const unsigned int v, const unsigned int f) noexcept
+    {
+        program.program_id = 0;
+
+        if (has_failed())
+            return;
+
+        if (const auto r = cache.load(v, f))
+        {
+            program.program_id = r;
+            builder.add(program, 0, 0, v, f);
+            return;
+        }
+
+        if (!inflate())
+            return;
+
+        const GLuint vertex_shader = start_shader(gl::VERTEX_SHADER, data(v));
+        const GLuint fragment_shader = start_shader(gl::FRAGMENT_SHADER, data(f));
+
+        if (vertex_shader && fragment_shader)
+        {
+            if (const auto r = start_program(vertex_shader, fragment_shader, cache.is_enabled()))
+            {
+                program.program_id = r;
+                builder.add(program, vertex_shader, fragment_shader, v, f);
+                return;
+            }
+        }
+
+        failed = true;
+    }
+
     bool has_failed() const noexcept
     {
         return failed;
@@ -167,46 +281,65 @@ public:
 };
 
 template<typename Call>
-void apply_to_all(core::program_container_t& con, const Call& call) noexcept
+void apply_to_render_programs(core::program_container_t& con, const Call& call) noexcept
 {
     call(con.render_final);
     call(con.render_masked);
-    call(con.render_blur);
+    call(con.render_kawase_down);
+    call(con.render_kawase_up);
+}
 
+template<typename Call>
+void apply_to_programs(core::program_container_t& con, const Call& call) noexcept
+{
     call(con.normal);
     call(con.fill);
     call(con.double_normal);
+    call(con.double_instanced);
     call(con.double_fill);
     call(con.text);
+    call(con.sdf_text);
+    call(con.dual_fill);
+    call(con.dual_text);
     call(con.fullbg);
     call(con.noise);
     call(con.gradient);
 }
 
-bool compile_shaders(core::program_container_t& prog) noexcept
+// Scene programs are only started here, render programs are needed by the very first frame and built right away
+bool compile_shaders(core::program_container_t& prog, program_builder& builder, const bool instancing) noexcept
 {
     using source = shaders::source_info;
-    shader_compiler<source::size_uncompressed> sc{ shaders::get_view() };
+    builder.start(shaders::get_view());
+    shader_compiler<source::size_uncompressed> sc{ shaders::get_view(), builder };
+
+    sc.start(prog.normal, source::pos_normv, source::pos_normf);
+    sc.start(prog.double_normal, source::pos_doublenormv, source::pos_normf);
+    if (instancing)
+        sc.start(prog.double_instanced, source::pos_doubleinstv, source::pos_normf);
+    else
+        prog.double_instanced.program_id = 0;
+    sc.start(prog.double_fill, source::pos_doublesolidv, source::pos_solidf);
+    sc.start(prog.fill, source::pos_solidv, source::pos_solidf);
+    sc.start(prog.text, source::pos_textv, source::pos_textf);
+    sc.start(prog.sdf_text, source::pos_textv, source::pos_sdftextf);
+    sc.start(prog.dual_fill, source::pos_dualsolidv, source::pos_dualsolidf);
+    sc.start(prog.dual_text, source::pos_dualtextv, source::pos_dualtextf);
+    sc.start(prog.fullbg, source::pos_solidv, source::pos_fullbgf);
+    sc.start(prog.noise, source::pos_normv, source::pos_noisef);
+    sc.start(prog.gradient, source::pos_gradientv, source::pos_gradientf);
 
     prog.render_final.program = sc.compile(source::pos_renderv, source::pos_renderf);
     prog.render_masked.program = sc.compile(source::pos_renderv, source::pos_maskedf);
-    prog.render_blur.program = sc.compile(source::pos_renderv, source::pos_simpleblurf);
-
-    prog.normal.program_id = sc.compile(source::pos_normv, source::pos_normf);
-    prog.double_normal.program_id = sc.compile(source::pos_doublenormv, source::pos_normf);
-    prog.double_fill.program_id = sc.compile(source::pos_doublesolidv, source::pos_solidf);
-    prog.fill.program_id = sc.compile(source::pos_solidv, source::pos_solidf);
-    prog.text.program_id = sc.compile(source::pos_textv, source::pos_textf);
-    prog.fullbg.program_id = sc.compile(source::pos_solidv, source::pos_fullbgf);
-    prog.noise.program_id = sc.compile(source::pos_normv, source::pos_noisef);
-    prog.gradient.program_id = sc.compile(source::pos_gradientv, source::pos_gradientf);
-
+    prog.render_kawase_down.program = sc.compile(source::pos_renderv, source::pos_kawasedownf);
+    prog.render_kawase_up.program = sc.compile(source::pos_renderv, source::pos_kawaseupf);
 
     if (sc.has_failed())
     {
         LOGE("Shader compilation failed.\n" "How unfortunate.");
         return false;
     }
+
     return true;
 }
 
@@ -243,17 +376,39 @@ GLint load_uniform(const GLuint program, const char* const variable_name) noexce
 
 bool core::setup_graphics() noexcept
 {
+    state::forget();
     gl::Disable(gl::CULL_FACE);
     gl::Disable(gl::DEPTH_TEST);
     gl::BlendFuncSeparate(gl::SRC_ALPHA, gl::ONE_MINUS_SRC_ALPHA, gl::ONE, gl::ONE_MINUS_SRC_ALPHA);
     gl::Enable(gl::BLEND);
 
-    if (!compile_shaders(prog))
+#ifdef __ANDROID__
+    instancing = gl::sys::IsVersionGEQ(3, 0)
+#else
+    instancing = gl::sys::IsVersionGEQ(3, 3)
+#endif
+        && gl::DrawArraysInstanced && gl::VertexAttribDivisor;
+
+    LOGD("Instanced drawing is %s", instancing ? "available" : "unavailable");
+
+    if (!compile_shaders(prog, builder, instancing))
     {
+        builder.abandon();
         return false;
     }
 
-    apply_to_all(prog, [] (auto& program) { program.prepare(); });
+    apply_to_render_programs(prog, [] (auto& program) { program.prepare(); });
+
+#ifdef __ANDROID__
+    idle::images::set_npot_support(gl::sys::IsVersionGEQ(3, 0) || gl::sys::IsExtensionSupported("GL_OES_texture_npot"));
+#else
+    idle::images::set_npot_support(true);
+#endif
+    gl::PixelStorei(gl::UNPACK_ALIGNMENT, 1);
+
+#ifdef IDLE_COMPILE_FPS_COUNTERS
+    timer.setup();
+#endif
 
 #if LOG_LEVEL > 3
     // Check openGL on the system
@@ -302,28 +457,39 @@ bool core::resize(const buffer_size window_size) noexcept
                 prog.double_normal,
                 prog.double_fill,
                 prog.text,
+                prog.sdf_text,
+                prog.dual_fill,
+                prog.dual_text,
                 prog.fullbg,
                 prog.noise
             )) return false;
 
     copy_projection_matrix(math::matrices::orthof_static<-1, 1, float>(0, draw_size.x, 0, draw_size.y));
 
-    prog.fullbg.use();
     prog.fullbg.set_resolution(math::point_cast<float>(window_size));
 
-    const auto actual_padded_pixel_size = appropriate_size(viewport_size);
     auto masked_size = viewport_size;
     masked_size.y *= 4;
     masked_size.y /= 3;
 
-    render_buffer_masked = std::make_unique<render_buffer_t>(masked_size, render_quality);
+    // Maps each view's clip space onto its rectangle within the masked buffer, matching view_mask and view_normal
+    const auto place_view = [&masked_size](GLfloat* out, const buffer_size origin, const buffer_size size, const bool mask)
+    {
+        const auto w = static_cast<GLfloat>(masked_size.x), h = static_cast<GLfloat>(masked_size.y);
+        out[0] = size.x / w;
+        out[1] = size.y / h;
+        out[2] = (2 * origin.x + size.x) / w - 1;
+        out[3] = (2 * origin.y + size.y) / h - 1;
+        out[4] = mask ? 1.f : 0.f;
+    };
 
-    prog.render_blur.use();
-    prog.render_blur.set_radius(1.f);
-    prog.render_blur.set_resolution(
-            static_cast<float>(viewport_size.y)
-            / static_cast<float>(actual_padded_pixel_size.y)
-            / draw_size.y);
+    constexpr auto stride = dual_view_program_t<program_t>::view_stride;
+    place_view(dual_views.data(), { 0, viewport_size.y }, viewport_size / 3, true);
+    place_view(dual_views.data() + stride, { 0, 0 }, viewport_size, false);
+
+    render_buffer_masked.reset();
+    render_targets.evict();
+    render_buffer_masked = render_targets.acquire(masked_size, render_quality);
 
     prog.render_masked.use();
     prog.render_masked.set_offsets(
@@ -337,66 +503,237 @@ bool core::resize(const buffer_size window_size) noexcept
 }
 
 
+namespace
+{
+
+constexpr GLuint unknown_binding = GLuint(-1);
+
+struct
+{
+    GLuint program = unknown_binding;
+    GLuint texture = unknown_binding;
+    state_stats frame, last_frame;
+}
+shadow_state;
+
+inline bool count_call(call_counter& counter, const bool redundant) noexcept
+{
+    ++(redundant ? counter.skipped : counter.issued);
+    return !redundant;
+}
+
+}  // namespace
+
+namespace state
+{
+
+void use_program(const GLuint program) noexcept
+{
+    if (count_call(shadow_state.frame.programs, shadow_state.program == program))
+    {
+        gl::UseProgram(program);
+        shadow_state.program = program;
+    }
+}
+
+void bind_texture(const GLuint texture) noexcept
+{
+    if (count_call(shadow_state.frame.textures, shadow_state.texture == texture))
+    {
+        gl::BindTexture(gl::TEXTURE_2D, texture);
+        shadow_state.texture = texture;
+    }
+}
+
+void forget_texture() noexcept
+{
+    shadow_state.texture = unknown_binding;
+}
+
+void forget() noexcept
+{
+    shadow_state.program = unknown_binding;
+    shadow_state.texture = unknown_binding;
+}
+
+void next_frame() noexcept
+{
+    shadow_state.last_frame = shadow_state.frame;
+    shadow_state.frame = {};
+}
+
+const state_stats& last_frame() noexcept
+{
+    return shadow_state.last_frame;
+}
+
+}  // namespace state
+
+void program_t::upload_model(const GLfloat *f) const noexcept
+{
+    if (count_call(shadow_state.frame.uniforms, shadow.model_known && std::equal(shadow.model.begin(), shadow.model.end(), f)))
+    {
+        gl::UniformMatrix4fv(model_handle, 1, gl::FALSE_, f);
+        std::copy_n(f, shadow.model.size(), shadow.model.begin());
+        shadow.model_known = true;
+    }
+}
+
+void program_t::upload_view(const GLfloat *f) const noexcept
+{
+    if (count_call(shadow_state.frame.uniforms, shadow.view_known && std::equal(shadow.view.begin(), shadow.view.end(), f)))
+    {
+        gl::UniformMatrix4fv(view_handle, 1, gl::FALSE_, f);
+        std::copy_n(f, shadow.view.size(), shadow.view.begin());
+        shadow.view_known = true;
+    }
+}
+
+void program_t::upload_color(const GLfloat r, const GLfloat g, const GLfloat b, const GLfloat a) const noexcept
+{
+    const std::array<GLfloat, 4> c { r, g, b, a };
+
+    if (count_call(shadow_state.frame.uniforms, shadow.color_known && shadow.color == c))
+    {
+        gl::Uniform4f(color_handle, r, g, b, a);
+        shadow.color = c;
+        shadow.color_known = true;
+    }
+}
+
 void program_t::set_transform(const idle::mat4x4_t& f) const noexcept
 {
-    gl::UniformMatrix4fv(model_handle, 1, gl::FALSE_, static_cast<const GLfloat*>(f));
+    upload_model(static_cast<const GLfloat*>(f));
 }
 
 void program_t::set_transform(const idle::mat4x4_noopt_t& f) const noexcept
 {
-    gl::UniformMatrix4fv(model_handle, 1, gl::FALSE_, static_cast<const GLfloat*>(f));
+    upload_model(static_cast<const GLfloat*>(f));
 }
 
 static constexpr auto identity_mat = idle::mat4x4_t{};
 
 void program_t::set_identity(void) const noexcept
 {
-    gl::UniformMatrix4fv(model_handle, 1, gl::FALSE_, static_cast<const GLfloat*>(identity_mat));
+    upload_model(static_cast<const GLfloat*>(identity_mat));
 }
 
 void program_t::set_view_transform(const idle::mat4x4_t& f) const noexcept
 {
-    gl::UniformMatrix4fv(view_handle, 1, gl::FALSE_, static_cast<const GLfloat*>(f));
+    upload_view(static_cast<const GLfloat*>(f));
 }
 
 void program_t::set_view_transform(const idle::mat4x4_noopt_t& f) const noexcept
 {
-    gl::UniformMatrix4fv(view_handle, 1, gl::FALSE_, static_cast<const GLfloat*>(f));
+    upload_view(static_cast<const GLfloat*>(f));
 }
 
 void program_t::set_view_identity(void) const noexcept
 {
-    gl::UniformMatrix4fv(view_handle, 1, gl::FALSE_, static_cast<const GLfloat*>(identity_mat));
+    upload_view(static_cast<const GLfloat*>(identity_mat));
 }
 
 void render_program_t::use() const noexcept
 {
-    gl::UseProgram(program);
+    state::use_program(program);
 }
 
 void program_t::use() const noexcept
 {
-    gl::UseProgram(program_id);
+    if (pending)
+        pending->finish(*this);
+
+    state::use_program(program_id);
+}
+
+bool program_t::is_ready() const noexcept
+{
+    return !pending && program_id;
+}
+
+void program_t::set_projection(const idle::mat4x4_noopt_t& f) noexcept
+{
+    std::memcpy(projection.data(), static_cast<const GLfloat*>(f), sizeof(projection));
+    projection_known = true;
+
+    if (is_ready())
+    {
+        use();
+        gl::UniformMatrix4fv(load_uniform(program_id, "u_projm"), 1, gl::FALSE_, projection.data());
+    }
 }
 
 void program_t::set_color(const idle::color_t& c) const noexcept
 {
-    gl::Uniform4f(color_handle, c.r, c.g, c.b, c.a);
+    upload_color(c.r, c.g, c.b, c.a);
 }
 
 void program_t::set_color(const idle::color_t& c, GLfloat custom_alpha) const noexcept
 {
-    gl::Uniform4f(color_handle, c.r, c.g, c.b, custom_alpha);
+    upload_color(c.r, c.g, c.b, custom_alpha);
+}
+
+void program_t::position_vertex(const GLfloat *f, const GLsizei stride) const noexcept
+{
+    gl::VertexAttribPointer(position_handle, 2, gl::FLOAT, gl::FALSE_, stride, f);
 }
 
-void program_t::position_vertex(const GLfloat *f) const noexcept
+void program_t::draw_arrays(const GLenum mode, const GLint first, const GLsizei count) const noexcept
 {
-    gl::VertexAttribPointer(position_handle, 2, gl::FLOAT, gl::FALSE_, 0, f);
+    if (instances)
+        gl::DrawArraysInstanced(mode, first, count, instances);
+    else
+        gl::DrawArrays(mode, first, count);
 }
 
-void textured_program_t::texture_vertex(const GLfloat *f) const noexcept
+template<typename Base>
+void dual_view_program_t<Base>::set_mask_color(const idle::color_t& c) const noexcept
 {
-    gl::VertexAttribPointer(texture_position_handle, 2, gl::FLOAT, gl::FALSE_, 0, f);
+    gl::Uniform4f(mask_color_handle, c.r, c.g, c.b, c.a);
+}
+
+template<typename Base>
+void dual_view_program_t<Base>::set_mask_color(const idle::color_t& c, const GLfloat custom_alpha) const noexcept
+{
+    gl::Uniform4f(mask_color_handle, c.r, c.g, c.b, custom_alpha);
+}
+
+template<typename Base>
+void dual_view_program_t<Base>::begin_views(const GLfloat *f) const noexcept
+{
+    constexpr auto stride = static_cast<GLsizei>(view_stride * sizeof(GLfloat));
+
+    vertex_buffer::unbind();
+    gl::EnableVertexAttribArray(view_location);
+    gl::EnableVertexAttribArray(view_mask_location);
+    gl::VertexAttribPointer(view_location, 4, gl::FLOAT, gl::FALSE_, stride, f);
+    gl::VertexAttribPointer(view_mask_location, 1, gl::FLOAT, gl::FALSE_, stride, f + 4);
+    gl::VertexAttribDivisor(view_location, 1);
+    gl::VertexAttribDivisor(view_mask_location, 1);
+    this->instances = 2;
+}
+
+template<typename Base>
+void dual_view_program_t<Base>::end_views() const noexcept
+{
+    gl::VertexAttribDivisor(view_location, 0);
+    gl::VertexAttribDivisor(view_mask_location, 0);
+    gl::DisableVertexAttribArray(view_location);
+    gl::DisableVertexAttribArray(view_mask_location);
+    this->instances = 0;
+    select_view(false);
+}
+
+template<typename Base>
+void dual_view_program_t<Base>::select_view(const bool mask) const noexcept
+{
+    gl::VertexAttrib4f(view_location, 1, 1, 0, 0);
+    gl::VertexAttrib1f(view_mask_location, mask ? 1.f : 0.f);
+}
+
+void textured_program_t::texture_vertex(const GLfloat *f, const GLsizei stride) const noexcept
+{
+    gl::VertexAttribPointer(texture_position_handle, 2, gl::FLOAT, gl::FALSE_, stride, f);
 }
 
 void double_base_program_t::destination_vertex(const GLfloat *f) const noexcept
@@ -404,9 +741,26 @@ void double_base_program_t::destination_vertex(const GLfloat *f) const noexcept
     gl::VertexAttribPointer(destination_handle, 2, gl::FLOAT, gl::FALSE_, 0, f);
 }
 
-void text_program_t::set_text_offset(const idle::point_t offset) const noexcept
+void text_program_t::color_vertex(const GLfloat *f, const GLsizei stride) const noexcept
+{
+    gl::VertexAttribPointer(vertex_color_handle, 4, gl::FLOAT, gl::FALSE_, stride, f);
+}
+
+void sdf_text_program_t::set_smoothing(const GLfloat s) const noexcept
+{
+    gl::Uniform1f(smoothing_handle, s);
+}
+
+void sdf_text_program_t::set_outline(const idle::color_t& c, const GLfloat width) const noexcept
+{
+    gl::Uniform4f(outline_color_handle, c.r, c.g, c.b, c.a);
+    gl::Uniform1f(outline_width_handle, width);
+}
+
+void sdf_text_program_t::set_glow(const idle::color_t& c, const GLfloat width) const noexcept
 {
-    gl::Uniform2f(font_offset_handle, offset.x, offset.y);
+    gl::Uniform4f(glow_color_handle, c.r, c.g, c.b, c.a);
+    gl::Uniform1f(glow_width_handle, width);
 }
 
 void double_base_program_t::set_interpolation(const GLfloat x) const noexcept
@@ -414,29 +768,65 @@ void double_base_program_t::set_interpolation(const GLfloat x) const noexcept
     gl::Uniform1f(interpolation_handle, x);
 }
 
-void double_vertex_program_t::set_texture_shift(const idle::point_t pt) const noexcept
+void texture_shift_base_program_t::set_texture_shift(const idle::point_t pt) const noexcept
 {
     gl::Uniform2f(face_shift_handle, pt.x, pt.y);
 }
 
-void double_vertex_program_t::set_texture_shift_internal(const idle::point_t pt) const noexcept
+void texture_shift_base_program_t::set_texture_shift_internal(const idle::point_t pt) const noexcept
 {
     gl::Uniform2f(internal_shift_handle, pt.x, pt.y);
 }
 
-void double_vertex_program_t::set_texture_mult(const idle::point_t pt) const noexcept
+void texture_shift_base_program_t::set_texture_mult(const idle::point_t pt) const noexcept
 {
     gl::Uniform2f(multiplier_handle, pt.x, pt.y);
 }
 
+void instanced_double_program_t::set_keyframes_size(const idle::point_t size) const noexcept
+{
+    gl::Uniform2f(keyframes_size_handle, size.x, size.y);
+}
+
+void instanced_double_program_t::instance_vertex(const GLfloat *f) const noexcept
+{
+    constexpr GLsizei stride = instance_stride * sizeof(GLfloat);
+    gl::VertexAttribPointer(instance_location, 3, gl::FLOAT, gl::FALSE_, stride, f);
+    gl::VertexAttribPointer(keyframes_location, 3, gl::FLOAT, gl::FALSE_, stride, f + 3);
+}
+
+void instanced_double_program_t::begin_instances() const noexcept
+{
+    for (const auto location : { instance_location, keyframes_location })
+    {
+        gl::EnableVertexAttribArray(location);
+        gl::VertexAttribDivisor(location, 1);
+    }
+}
+
+void instanced_double_program_t::end_instances() const noexcept
+{
+    for (const auto location : { instance_location, keyframes_location })
+    {
+        gl::VertexAttribDivisor(location, 0);
+        gl::DisableVertexAttribArray(location);
+    }
+}
+
 void fullbg_program_t::set_offset(const GLfloat x) const noexcept
 {
     gl::Uniform1f(offset_handle, x);
 }
 
-void fullbg_program_t::set_resolution(const idle::point_t res) const noexcept
+void fullbg_program_t::set_resolution(const idle::point_t res) noexcept
 {
-    gl::Uniform2f(resolution_handle, res.x, res.y);
+    resolution = res;
+
+    if (is_ready())
+    {
+        use();
+        gl::Uniform2f(resolution_handle, res.x, res.y);
+    }
 }
 
 void noise_program_t::set_secondary_color(const idle::color_t& c) const noexcept
@@ -469,24 +859,26 @@ void gradient_program_t::set_secondary_color(const idle::color_t& c, const float
     gl::Uniform4f(secondary_color_handle, c.r, c.g, c.b, alpha);
 }
 
-void gradient_program_t::interpolation_vertex(const GLfloat *f) const noexcept
+void gradient_program_t::interpolation_vertex(const GLfloat *f, const GLsizei stride) const noexcept
 {
-    gl::VertexAttribPointer(interpolation_handle, 1, gl::FLOAT, gl::FALSE_, 0, f);
+    gl::VertexAttribPointer(interpolation_handle, 1, gl::FLOAT, gl::FALSE_, stride, f);
 }
 
-void blur_render_program_t::set_direction(const GLfloat x, const GLfloat y) const noexcept
+void kawase_render_program_t::set_offset(const GLfloat x) const noexcept
 {
-    gl::Uniform2f(direction_handle, x, y);
+    gl::Uniform1f(offset_handle, x);
 }
 
-void blur_render_program_t::set_radius(const GLfloat rad) const noexcept
+void kawase_render_program_t::draw_buffer(const render_buffer_t& src) const noexcept
 {
-    gl::Uniform1f(radius_handle, rad);
-}
+    use();
 
-void blur_render_program_t::set_resolution(const GLfloat res) const noexcept
-{
-    gl::Uniform1f(resolution_handle, res);
+    const auto half_texel_x = src.texture_w / static_cast<GLfloat>(src.internal_size.x) / 2;
+    const auto half_texel_y = src.texture_h / static_cast<GLfloat>(src.internal_size.y) / 2;
+
+    gl::Uniform2f(halfpixel_handle, half_texel_x, half_texel_y);
+    gl::Uniform2f(limit_handle, src.texture_w - half_texel_x, src.texture_h - half_texel_y);
+    render_program_t::draw_buffer(src);
 }
 
 void masked_render_program_t::set_offsets(const GLfloat ratio1, const GLfloat ratio2, const GLfloat buffer_height, const GLfloat subbuffer_width) const noexcept
@@ -503,6 +895,7 @@ void render_program_t::prepare() noexcept
 
 void program_t::prepare() noexcept
 {
+    shadow = {};
     use();
     position_handle = load_attribute(program_id, "attr_pos");
     model_handle = load_uniform(program_id, "u_modelm");
@@ -511,6 +904,10 @@ void program_t::prepare() noexcept
 
     set_identity();
     set_view_identity();
+
+    if (projection_known)
+        gl::UniformMatrix4fv(load_uniform(program_id, "u_projm"), 1, gl::FALSE_, projection.data());
+
     report_opengl_errors("program_t::prepare()");
 }
 
@@ -543,10 +940,25 @@ void gradient_program_t::prepare() noexcept
 void text_program_t::prepare() noexcept
 {
     textured_program_t::prepare();
-    font_offset_handle = load_uniform(program_id, "u_offset");
+    vertex_color_handle = load_attribute(program_id, "attr_color");
     report_opengl_errors("text_program_t::prepare()");
 }
 
+void sdf_text_program_t::prepare() noexcept
+{
+    text_program_t::prepare();
+    outline_color_handle = load_uniform(program_id, "u_outline_color");
+    glow_color_handle = load_uniform(program_id, "u_glow_color");
+    smoothing_handle = load_uniform(program_id, "u_smoothing");
+    outline_width_handle = load_uniform(program_id, "u_outline_width");
+    glow_width_handle = load_uniform(program_id, "u_glow_width");
+
+    set_smoothing(.1f);
+    set_outline({0, 0, 0, 0}, 0);
+    set_glow({0, 0, 0, 0}, 0);
+    report_opengl_errors("sdf_text_program_t::prepare()");
+}
+
 void fullbg_program_t::prepare() noexcept
 {
     program_t::prepare();
@@ -554,6 +966,7 @@ void fullbg_program_t::prepare() noexcept
     resolution_handle = load_uniform(program_id, "u_resolution");
 
     set_offset(0);
+    gl::Uniform2f(resolution_handle, resolution.x, resolution.y);
     report_opengl_errors("fullbg_program_t::prepare()");
 }
 
@@ -573,28 +986,67 @@ void double_solid_program_t::prepare() noexcept
     double_base_program_t::prepare_headless(program_id);
 }
 
-void double_vertex_program_t::prepare() noexcept
+void texture_shift_base_program_t::prepare_headless(const GLuint prog) noexcept
 {
-    textured_program_t::prepare();
-    double_base_program_t::prepare_headless(program_id);
-    internal_shift_handle = load_uniform(program_id, "u_map_shift1");
-    face_shift_handle = load_uniform(program_id, "u_map_shift2");
-    multiplier_handle = load_uniform(program_id, "u_map_mult");
+    internal_shift_handle = load_uniform(prog, "u_map_shift1");
+    face_shift_handle = load_uniform(prog, "u_map_shift2");
+    multiplier_handle = load_uniform(prog, "u_map_mult");
 
     set_texture_shift({0, 0});
     set_texture_shift_internal({0, 0});
     set_texture_mult({1, 1});
 }
 
-void blur_render_program_t::prepare() noexcept
+void double_vertex_program_t::prepare() noexcept
+{
+    textured_program_t::prepare();
+    double_base_program_t::prepare_headless(program_id);
+    texture_shift_base_program_t::prepare_headless(program_id);
+}
+
+void instanced_double_program_t::prepare() noexcept
+{
+    textured_program_t::prepare();
+    texture_shift_base_program_t::prepare_headless(program_id);
+    keyframes_size_handle = load_uniform(program_id, "u_keyframes_size");
+    gl::Uniform1i(load_uniform(program_id, "u_keyframes"), keyframes_unit - gl::TEXTURE0);
+
+    for (const auto& [name, pinned] : { std::pair{ "attr_instance", instance_location }, std::pair{ "attr_keyframes", keyframes_location } })
+    {
+        if (const auto location = gl::GetAttribLocation(program_id, name); location < 0)
+        {
+            LOGE("%s is missing from the instanced program", name);
+        }
+        else if (static_cast<GLuint>(location) != pinned)
+        {
+            LOGE("%s is at %d instead of %u, instanced drawing would disturb other programs", name, location, pinned);
+        }
+    }
+    report_opengl_errors("instanced_double_program_t::prepare()");
+}
+
+template<typename Base>
+void dual_view_program_t<Base>::prepare() noexcept
+{
+    Base::prepare();
+    mask_color_handle = load_uniform(this->program_id, "u_mask_color");
+
+    set_mask_color({0, 0, 0, 1});
+    select_view(false);
+    report_opengl_errors("dual_view_program_t::prepare()");
+}
+
+template struct dual_view_program_t<program_t>;
+template struct dual_view_program_t<text_program_t>;
+
+void kawase_render_program_t::prepare() noexcept
 {
     render_program_t::prepare();
-    direction_handle = load_uniform(program, "u_direction");
-    resolution_handle = load_uniform(program, "u_resolution");
-    radius_handle = load_uniform(program, "u_radius");
+    halfpixel_handle = load_uniform(program, "u_halfpixel");
+    limit_handle = load_uniform(program, "u_limit");
+    offset_handle = load_uniform(program, "u_offset");
 
-    set_direction(1, 0);
-    set_radius(1.f);
+    set_offset(1.f);
 }
 
 void masked_render_program_t::prepare() noexcept
@@ -621,8 +1073,7 @@ void render_program_t::draw_buffer(const render_buffer_t& src) const noexcept
 
     use();
 
-    gl::ActiveTexture(gl::TEXTURE0);
-    gl::BindTexture(gl::TEXTURE_2D, src.texture);
+    state::bind_texture(src.texture);
     gl::VertexAttribPointer(position_handle, 2, gl::FLOAT, gl::FALSE_, 0, v);
     gl::VertexAttribPointer(texture_position_handle, 2, gl::FLOAT, gl::FALSE_, 0, t);
     gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
@@ -630,27 +1081,170 @@ void render_program_t::draw_buffer(const render_buffer_t& src) const noexcept
 
 
 
-static void set_projection_matrix(const program_t& prog, const idle::mat4x4_noopt_t& mat) noexcept
+void core::copy_projection_matrix(const idle::mat4x4_noopt_t& projection_matrix) noexcept
+{
+    apply_to_programs(prog, [&projection_matrix] (program_t& program) { program.set_projection(projection_matrix); });
+}
+
+render_target core::new_render_buffer(const unsigned div) const noexcept
+{
+    return render_targets.acquire(viewport_size / div, render_quality);
+}
+
+dual_blur::dual_blur(const core& gl, const buffer_size source_size, const unsigned levels) noexcept
+{
+    chain.reserve(levels);
+    auto size = source_size;
+
+    // The first level is kept even for a 1px source, result() always has a buffer to return
+    for (unsigned i = 0; i < std::max(levels, 1u) && (i == 0 || (size.x > 1 && size.y > 1)); ++i)
+    {
+        size = { std::max(size.x / 2, 1u), std::max(size.y / 2, 1u) };
+        chain.push_back(gl.render_targets.acquire(size, gl::LINEAR));
+    }
+}
+
+const render_buffer_t& dual_blur::apply(const core& gl, const render_buffer_t& source, const GLfloat offset) const noexcept
+{
+    GLint default_frame_buffer, viewport[4];
+    gl::GetIntegerv(gl::FRAMEBUFFER_BINDING, &default_frame_buffer);
+    gl::GetIntegerv(gl::VIEWPORT, viewport);
+
+    const auto pass = [&](const kawase_render_program_t& program, const render_buffer_t& from, const render_buffer_t& to)
+    {
+        gl::BindFramebuffer(gl::FRAMEBUFFER, to.buffer_frame);
+        gl::Viewport(0, 0, to.internal_size.x, to.internal_size.y);
+        program.draw_buffer(from);
+    };
+
+    gl.prog.render_kawase_down.use();
+    gl.prog.render_kawase_down.set_offset(offset);
+
+    const render_buffer_t* from = &source;
+    for (const auto& it : chain)
+    {
+        pass(gl.prog.render_kawase_down, *from, *it);
+        from = &*it;
+    }
+
+    gl.prog.render_kawase_up.use();
+    gl.prog.render_kawase_up.set_offset(offset);
+
+    for (auto i = chain.size(); i-- > 1;)
+    {
+        pass(gl.prog.render_kawase_up, *chain[i], *chain[i - 1]);
+    }
+
+    gl::BindFramebuffer(gl::FRAMEBUFFER, default_frame_buffer);
+    gl::Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    return result();
+}
+
+const render_buffer_t& dual_blur::result() const noexcept
+{
+    return *chain.front();
+}
+
+void dual_blur::reset() noexcept
+{
+    chain.clear();
+}
+
+render_target::render_target(std::unique_ptr<render_buffer_t> buf, render_target_pool* const owner, const GLint qual, const unsigned ep) noexcept
+    : buffer{ std::move(buf) }, pool{ owner }, quality{ qual }, epoch{ ep }
 {
-    prog.use();
-    gl::UniformMatrix4fv(load_uniform(prog.program_id, "u_projm"), 1, gl::FALSE_, static_cast<const GLfloat*>(mat));
 }
 
-void core::copy_projection_matrix(const idle::mat4x4_noopt_t& projection_matrix) const noexcept
+render_target& render_target::operator=(render_target&& other) noexcept
 {
-    set_projection_matrix(prog.normal, projection_matrix);
-    set_projection_matrix(prog.fill, projection_matrix);
-    set_projection_matrix(prog.double_normal, projection_matrix);
-    set_projection_matrix(prog.double_fill, projection_matrix);
-    set_projection_matrix(prog.text, projection_matrix);
-    set_projection_matrix(prog.fullbg, projection_matrix);
-    set_projection_matrix(prog.noise, projection_matrix);
-    set_projection_matrix(prog.gradient, projection_matrix);
+    reset();
+    buffer = std::move(other.buffer);
+    pool = other.pool;
+    quality = other.quality;
+    epoch = other.epoch;
+    return *this;
 }
 
-std::unique_ptr<const render_buffer_t> core::new_render_buffer(const unsigned div) const noexcept
+render_target::~render_target() noexcept
 {
-    return std::make_unique<const render_buffer_t>(viewport_size / div, render_quality);
+    reset();
+}
+
+void render_target::reset() noexcept
+{
+    if (buffer)
+        pool->release(std::move(buffer), quality, epoch);
+}
+
+const render_buffer_t& render_target::operator*() const noexcept
+{
+    return *buffer;
+}
+
+const render_buffer_t* render_target::operator->() const noexcept
+{
+    return buffer.get();
+}
+
+render_target::operator bool() const noexcept
+{
+    return !!buffer;
+}
+
+render_target render_target_pool::acquire(const buffer_size size, const GLint quality) noexcept
+{
+    ++stats.leased;
+
+    const auto it = std::find_if(spare.begin(), spare.end(), [size, quality](const entry& e)
+            {
+                return e.quality == quality && e.buffer->internal_size.x == size.x && e.buffer->internal_size.y == size.y;
+            });
+
+    if (it != spare.end())
+    {
+        auto buffer = std::move(it->buffer);
+        spare.erase(it);
+        ++stats.reused;
+        stats.pooled = static_cast<unsigned>(spare.size());
+        return { std::move(buffer), this, quality, epoch };
+    }
+
+    ++stats.created;
+    return { std::make_unique<render_buffer_t>(size, quality), this, quality, epoch };
+}
+
+void render_target_pool::release(std::unique_ptr<render_buffer_t> buffer, const GLint quality, const unsigned lease_epoch) noexcept
+{
+    --stats.leased;
+
+    if (lease_epoch != epoch)
+    {
+        ++stats.evicted;
+        return;
+    }
+
+    if (spare.size() >= max_spare)
+    {
+        spare.erase(spare.begin());
+        ++stats.evicted;
+    }
+
+    spare.push_back({ std::move(buffer), quality });
+    stats.pooled = static_cast<unsigned>(spare.size());
+}
+
+void render_target_pool::evict() noexcept
+{
+    LOGDD("Evicting %zu pooled render buffers", spare.size());
+    stats.evicted += static_cast<unsigned>(spare.size());
+    spare.clear();
+    stats.pooled = 0;
+    ++epoch;
+}
+
+const render_target_stats& render_target_pool::get_stats() const noexcept
+{
+    return stats;
 }
 
 render_buffer_t::~render_buffer_t() noexcept
@@ -659,6 +1253,7 @@ render_buffer_t::~render_buffer_t() noexcept
     gl::DeleteFramebuffers(1, &buffer_frame);
     gl::DeleteTextures(1, &texture);
     gl::DeleteRenderbuffers(1, &buffer_depth);
+    state::forget_texture();
 }
 
 render_buffer_t::render_buffer_t(const buffer_size tex_size, const GLint quality) noexcept
@@ -670,7 +1265,7 @@ render_buffer_t::render_buffer_t(const buffer_size tex_size, const GLint quality
 
     report_opengl_errors("render_buffer_t::render_buffer_t");
 
-    gl::BindTexture(gl::TEXTURE_2D, texture);
+    state::bind_texture(texture);
     gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, quality);
     gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, quality);
     gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE);
@@ -693,16 +1288,159 @@ render_buffer_t::render_buffer_t(const buffer_size tex_size, const GLint quality
 
     report_opengl_errors("render_buffer_t::render_buffer_t");
 
-    gl::BindTexture(gl::TEXTURE_2D, 0);
+    state::bind_texture(0);
     gl::BindRenderbuffer(gl::RENDERBUFFER, 0);
     gl::BindFramebuffer(gl::FRAMEBUFFER, 0);
 }
 
+void program_builder::start(const std::string_view shader_source) noexcept
+{
+    abandon();
+    started = std::chrono::steady_clock::now();
+    finished = restored = failed = 0;
+    binaries.open(shader_source);
+
+    parallel = gl::MaxShaderCompilerThreads
+        && (gl::sys::IsExtensionSupported("GL_KHR_parallel_shader_compile")
+            || gl::sys::IsExtensionSupported("GL_ARB_parallel_shader_compile"));
+
+    if (parallel)
+    {
+        // Lets the driver pick the number of threads
+        gl::MaxShaderCompilerThreads(0xffffffffu);
+    }
+
+    LOGD("Parallel shader compilation is %s", parallel ? "available" : "unavailable");
+}
+
+program_cache& program_builder::cache() noexcept
+{
+    return binaries;
+}
+
+void program_builder::add(program_t& program, void (*prepare)(program_t&) noexcept, const GLuint vertex_shader, const GLuint fragment_shader, const unsigned vertex, const unsigned fragment) noexcept
+{
+    program.pending = this;
+    pending.push_back({ &program, prepare, vertex_shader, fragment_shader, vertex, fragment });
+}
+
+void program_builder::finish(const program_t& program) noexcept
+{
+    if (const auto it = std::find_if(pending.begin(), pending.end(), [&program](const entry& e) { return e.program == &program; });
+            it != pending.end())
+    {
+        finish(it);
+    }
+    else
+    {
+        program.pending = nullptr;
+    }
+}
+
+void program_builder::finish(const std::vector<entry>::iterator it) noexcept
+{
+    const auto e = *it;
+    pending.erase(it);
+
+    auto& program = *e.program;
+    program.pending = nullptr;
+
+    if (!e.vertex_shader)
+    {
+        ++restored;
+    }
+    else
+    {
+        if (shader_compiled(e.vertex_shader) && shader_compiled(e.fragment_shader) && program_linked(program.program_id))
+        {
+            binaries.store(program.program_id, e.vertex, e.fragment);
+        }
+        else
+        {
+            LOGE("Program %u is unusable", program.program_id);
+            gl::DeleteProgram(program.program_id);
+            program.program_id = 0;
+            ++failed;
+        }
+
+        gl::DeleteShader(e.vertex_shader);
+        gl::DeleteShader(e.fragment_shader);
+    }
+
+    if (program.program_id)
+    {
+        e.prepare(program);
+        ++finished;
+    }
+
+    if (pending.empty())
+    {
+        LOGI("Programs ready %.1f ms after setup: %u finished (%u from cache), %u failed",
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count(),
+                finished, restored, failed);
+        binaries.save();
+    }
+}
+
+void program_builder::poll() noexcept
+{
+    if (!parallel)
+        return;
+
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+        GLint done = gl::TRUE_;
+
+        if (it->vertex_shader)
+            gl::GetProgramiv(it->program->program_id, gl::COMPLETION_STATUS, &done);
+
+        if (done)
+        {
+            const auto index = it - pending.begin();
+            finish(it);
+            it = pending.begin() + index;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+std::size_t program_builder::pending_count() const noexcept
+{
+    return pending.size();
+}
+
+bool program_builder::has_failed() const noexcept
+{
+    return failed != 0;
+}
+
+void program_builder::flush() noexcept
+{
+    binaries.save();
+}
+
+void program_builder::abandon() noexcept
+{
+    for (const auto& it : pending)
+        it.program->pending = nullptr;
+
+    pending.clear();
+}
+
 void core::clean() noexcept
 {
+    builder.flush();
+    builder.abandon();
     fonts.regular.reset();
     fonts.title.reset();
     render_buffer_masked.reset();
+    render_targets.evict();
+    timer.clean();
+    vertex_buffer::invalidate_context();
+    state::forget();
 }
 
 void core::view_normal() const noexcept
@@ -720,6 +1458,11 @@ void core::view_distortion() const noexcept
     gl::Viewport(viewport_size.x / 3, viewport_size.y, viewport_size.x / 3, viewport_size.y / 3);
 }
 
+void core::view_dual() const noexcept
+{
+    gl::Viewport(0, 0, viewport_size.x, viewport_size.y * 4 / 3);
+}
+
 unique_texture::unique_texture(const GLuint val) noexcept : value{val}
 {
 }
@@ -742,6 +1485,7 @@ unique_texture::~unique_texture() noexcept
     {
         LOGDD("Destroying unique texture #%u", value);
         gl::DeleteTextures(1, &value);
+        state::forget_texture();
     }
 }
 
@@ -750,6 +1494,229 @@ GLuint unique_texture::get() const noexcept
     return value;
 }
 
+namespace
+{
+
+std::atomic<unsigned> context_generation = 1;
+
+struct buffer_trash_t
+{
+    std::mutex mutex;
+    std::vector<std::pair<GLuint, unsigned>> ids, textures;
+};
+
+buffer_trash_t& buffer_trash() noexcept
+{
+    // Never destroyed, buffers held by other static objects are dropped at exit
+    static auto* const trash = new buffer_trash_t{};
+    return *trash;
+}
+
+}  // namespace
+
+vertex_buffer::vertex_buffer(vertex_buffer&& other) noexcept : value{other.value}, generation{other.generation}
+{
+    other.value = 0;
+}
+
+vertex_buffer& vertex_buffer::operator=(vertex_buffer&& other) noexcept
+{
+    std::swap(value, other.value);
+    std::swap(generation, other.generation);
+    return *this;
+}
+
+vertex_buffer::~vertex_buffer() noexcept
+{
+    if (value)
+    {
+        auto& trash = buffer_trash();
+        const std::lock_guard lock{ trash.mutex };
+        trash.ids.emplace_back(value, generation);
+    }
+}
+
+bool vertex_buffer::is_current() const noexcept
+{
+    return value && generation == context_generation.load(std::memory_order_relaxed);
+}
+
+void vertex_buffer::upload(const void* const data, const GLsizeiptr size, const GLenum usage) noexcept
+{
+    if (!is_current())
+    {
+        gl::GenBuffers(1, &value);
+        generation = context_generation.load(std::memory_order_relaxed);
+        LOGDD("Created vertex buffer #%u", value);
+    }
+
+    gl::BindBuffer(gl::ARRAY_BUFFER, value);
+    gl::BufferData(gl::ARRAY_BUFFER, size, data, usage);
+    report_opengl_errors("vertex_buffer::upload");
+}
+
+void vertex_buffer::bind() const noexcept
+{
+    gl::BindBuffer(gl::ARRAY_BUFFER, value);
+}
+
+void vertex_buffer::unbind() noexcept
+{
+    gl::BindBuffer(gl::ARRAY_BUFFER, 0);
+}
+
+void vertex_buffer::clean_trash() noexcept
+{
+    const auto current = context_generation.load(std::memory_order_relaxed);
+    auto& trash = buffer_trash();
+    const std::lock_guard lock{ trash.mutex };
+
+    for (const auto& [id, gen] : trash.ids)
+    {
+        if (gen == current)
+        {
+            LOGDD("Destroying vertex buffer #%u", id);
+            gl::DeleteBuffers(1, &id);
+        }
+    }
+    trash.ids.clear();
+
+    for (const auto& [id, gen] : trash.textures)
+    {
+        if (gen == current)
+        {
+            LOGDD("Destroying table texture #%u", id);
+            gl::DeleteTextures(1, &id);
+        }
+    }
+    trash.textures.clear();
+}
+
+void vertex_buffer::invalidate_context() noexcept
+{
+    clean_trash();
+    context_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+table_texture::table_texture(table_texture&& other) noexcept : value{other.value}, generation{other.generation}
+{
+    other.value = 0;
+}
+
+table_texture& table_texture::operator=(table_texture&& other) noexcept
+{
+    std::swap(value, other.value);
+    std::swap(generation, other.generation);
+    return *this;
+}
+
+table_texture::~table_texture() noexcept
+{
+    if (value)
+    {
+        auto& trash = buffer_trash();
+        const std::lock_guard lock{ trash.mutex };
+        trash.textures.emplace_back(value, generation);
+    }
+}
+
+bool table_texture::is_current() const noexcept
+{
+    return value && generation == context_generation.load(std::memory_order_relaxed);
+}
+
+void table_texture::upload(const GLfloat* const data, const GLsizei width, const GLsizei height, const GLenum unit) noexcept
+{
+    gl::ActiveTexture(unit);
+    if (!is_current())
+    {
+        gl::GenTextures(1, &value);
+        generation = context_generation.load(std::memory_order_relaxed);
+        LOGDD("Created table texture #%u", value);
+    }
+
+    gl::BindTexture(gl::TEXTURE_2D, value);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE);
+    gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RG32F, width, height, 0, gl::RG, gl::FLOAT, data);
+    gl::ActiveTexture(gl::TEXTURE0);
+    report_opengl_errors("table_texture::upload");
+}
+
+void table_texture::bind(const GLenum unit) const noexcept
+{
+    gl::ActiveTexture(unit);
+    gl::BindTexture(gl::TEXTURE_2D, value);
+    gl::ActiveTexture(gl::TEXTURE0);
+}
+
+stream_allocation stream_buffer::allocate(const GLsizeiptr size) noexcept
+{
+    const auto aligned = (size + alignment - 1) & ~(alignment - 1);
+
+    if (aligned > capacity)
+    {
+        if (capacity)
+        {
+            ++stats.grows;
+            LOGW("Stream buffer too small for %li bytes", static_cast<long>(size));
+        }
+
+        capacity = std::max(default_capacity, static_cast<GLsizeiptr>(std::bit_ceil(static_cast<size_t>(aligned))));
+        staging = std::make_unique<std::byte[]>(capacity);
+        buffer.upload(nullptr, capacity, gl::STREAM_DRAW);
+        head = 0;
+    }
+    else if (!buffer.is_current() || head + aligned > capacity)
+    {
+        if (buffer.is_current())
+            ++stats.wraps;
+
+        buffer.upload(nullptr, capacity, gl::STREAM_DRAW);
+        head = 0;
+    }
+
+    pending_begin = head;
+    pending_end = head + size;
+    head += aligned;
+
+    frame_bytes += aligned;
+    ++frame_allocations;
+
+    return {
+        reinterpret_cast<GLfloat*>(staging.get() + pending_begin),
+        reinterpret_cast<const GLfloat*>(pending_begin)
+    };
+}
+
+void stream_buffer::flush() noexcept
+{
+    buffer.bind();
+    gl::BufferSubData(gl::ARRAY_BUFFER, pending_begin, pending_end - pending_begin, staging.get() + pending_begin);
+    report_opengl_errors("stream_buffer::flush");
+}
+
+void stream_buffer::bind() const noexcept
+{
+    buffer.bind();
+}
+
+void stream_buffer::next_frame() noexcept
+{
+    stats.bytes_last_frame = frame_bytes;
+    stats.peak_bytes_per_frame = std::max(stats.peak_bytes_per_frame, frame_bytes);
+    stats.allocations_last_frame = frame_allocations;
+    frame_bytes = 0;
+    frame_allocations = 0;
+}
+
+const stream_stats& stream_buffer::get_stats() const noexcept
+{
+    return stats;
+}
+
 bool assert_opengl_errors() noexcept
 {
     if (auto error = gl::GetError(); error != gl::NO_ERROR_)
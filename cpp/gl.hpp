@@ -19,14 +19,19 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <optional>
+#include <vector>
 #include <math.hpp>
 #include <log.hpp>
 
 #include "platform/pointer.hpp"
 #include "platform/opengl_core_adaptive.hpp"
 #include "gl_programs.hpp"
+#include "gpu_timer.hpp"
+#include "program_cache.hpp"
 #include "fonts.hpp"
 
 namespace graphics
@@ -53,6 +58,72 @@ struct render_buffer_t
     ~render_buffer_t() noexcept;
 };
 
+class render_target_pool;
+
+// Render buffer on loan from a render_target_pool, handed back when reset or destroyed
+class render_target
+{
+    friend class render_target_pool;
+
+    std::unique_ptr<render_buffer_t> buffer;
+    render_target_pool* pool = nullptr;
+    GLint quality = 0;
+    unsigned epoch = 0;
+
+    render_target(std::unique_ptr<render_buffer_t> buf, render_target_pool* owner, GLint quality, unsigned epoch) noexcept;
+
+public:
+    render_target() noexcept = default;
+
+    render_target(render_target&&) noexcept = default;
+
+    render_target& operator=(render_target&& other) noexcept;
+
+    ~render_target() noexcept;
+
+    void reset() noexcept;
+
+    const render_buffer_t& operator*() const noexcept;
+
+    const render_buffer_t* operator->() const noexcept;
+
+    explicit operator bool() const noexcept;
+};
+
+struct render_target_stats
+{
+    unsigned created = 0, reused = 0, evicted = 0;
+    unsigned leased = 0, pooled = 0;
+};
+
+// Keeps released render buffers around for requests of the same size and filtering;
+// buffers leased before an eviction are deleted instead of coming back.
+class render_target_pool
+{
+    friend class render_target;
+
+    struct entry
+    {
+        std::unique_ptr<render_buffer_t> buffer;
+        GLint quality;
+    };
+
+    std::vector<entry> spare;
+    render_target_stats stats;
+    unsigned epoch = 0;
+
+    void release(std::unique_ptr<render_buffer_t> buffer, GLint quality, unsigned lease_epoch) noexcept;
+
+public:
+    static constexpr std::size_t max_spare = 6;
+
+    render_target acquire(buffer_size size, GLint quality) noexcept;
+
+    void evict() noexcept;
+
+    const render_target_stats& get_stats() const noexcept;
+};
+
 struct render_program_t
 {
     GLuint program = 0;
@@ -68,19 +139,18 @@ public:
     void prepare() noexcept;
 };
 
-struct blur_render_program_t : render_program_t
+struct kawase_render_program_t : render_program_t
 {
 private:
-    GLint direction_handle = 0, resolution_handle = 0, radius_handle = 0;
+    GLint halfpixel_handle = 0, limit_handle = 0, offset_handle = 0;
 
 public:
     void prepare() noexcept;
 
-    void set_radius(GLfloat x) const noexcept;
+    void set_offset(GLfloat x) const noexcept;
 
-    void set_resolution(GLfloat x) const noexcept;
-
-    void set_direction(GLfloat x, GLfloat y) const noexcept;
+    // Sets the sampling steps after the source, then draws it
+    void draw_buffer(const render_buffer_t& source) const noexcept;
 };
 
 struct masked_render_program_t : render_program_t
@@ -94,19 +164,117 @@ public:
     void set_offsets(GLfloat ratio1, GLfloat ratio2, GLfloat buffer_height, GLfloat subbuffer_width) const noexcept;
 };
 
+struct stream_stats
+{
+    GLsizeiptr bytes_last_frame = 0, peak_bytes_per_frame = 0;
+    unsigned allocations_last_frame = 0;
+    unsigned wraps = 0;  // the ring was orphaned and restarted
+    unsigned grows = 0;  // a request did not fit at all and the storage had to grow
+};
+
+struct stream_allocation
+{
+    GLfloat* data;  // write pointer
+    const GLfloat* offset;  // for the program wrappers, valid while the stream is bound
+};
+
+// Ring of vertex memory for per-frame data; a single allocation is in flight at a time:
+// allocate, write, flush, point the attributes at the offset and draw.
+class stream_buffer
+{
+    vertex_buffer buffer;
+    std::unique_ptr<std::byte[]> staging;
+    GLsizeiptr capacity = 0, head = 0, pending_begin = 0, pending_end = 0;
+    GLsizeiptr frame_bytes = 0;
+    unsigned frame_allocations = 0;
+    stream_stats stats;
+
+public:
+    static constexpr GLsizeiptr default_capacity = 256 * 1024;
+    static constexpr GLsizeiptr alignment = 16;
+
+    stream_allocation allocate(GLsizeiptr size) noexcept;
+
+    // Uploads the last allocation and leaves the buffer bound
+    void flush() noexcept;
+
+    // Rebinds after another buffer took its place, the flushed data stays valid
+    void bind() const noexcept;
+
+    void next_frame() noexcept;
+
+    const stream_stats& get_stats() const noexcept;
+};
+
+// Programs are linked in the background and finished by their first use(). With GL_KHR_parallel_shader_compile
+// the driver builds them on its own threads and poll() picks up the finished ones without waiting.
+class program_builder
+{
+    struct entry
+    {
+        program_t* program;
+        void (*prepare)(program_t&) noexcept;
+        GLuint vertex_shader, fragment_shader;  // zero when restored from the cache
+        unsigned vertex, fragment;
+    };
+
+    std::vector<entry> pending;
+    program_cache binaries;
+    std::chrono::steady_clock::time_point started;
+    unsigned finished = 0, restored = 0, failed = 0;
+    bool parallel = false;
+
+    void add(program_t& program, void (*prepare)(program_t&) noexcept, GLuint vertex_shader, GLuint fragment_shader, unsigned vertex, unsigned fragment) noexcept;
+
+    void finish(std::vector<entry>::iterator it) noexcept;
+
+public:
+    void start(std::string_view shader_source) noexcept;
+
+    program_cache& cache() noexcept;
+
+    template<typename Program>
+    void add(Program& program, const GLuint vertex_shader, const GLuint fragment_shader, const unsigned vertex, const unsigned fragment) noexcept
+    {
+        add(program, [](program_t& p) noexcept { static_cast<Program&>(p).prepare(); },
+                vertex_shader, fragment_shader, vertex, fragment);
+    }
+
+    // Waits for the link if it is still going
+    void finish(const program_t& program) noexcept;
+
+    void poll() noexcept;
+
+    std::size_t pending_count() const noexcept;
+
+    // Whether any link failed since start
+    bool has_failed() const noexcept;
+
+    // Writes the binaries of the programs finished so far
+    void flush() noexcept;
+
+    // The programs went away with the context
+    void abandon() noexcept;
+};
+
 struct core
 {
     struct program_container_t
     {
         render_program_t render_final;
         masked_render_program_t render_masked;
-        blur_render_program_t render_blur;
+        kawase_render_program_t render_kawase_down;
+        kawase_render_program_t render_kawase_up;
 
         textured_program_t normal;
         program_t fill;
         double_vertex_program_t double_normal;
+        instanced_double_program_t double_instanced;
         double_solid_program_t double_fill;
         text_program_t text;
+        sdf_text_program_t sdf_text;
+        dual_view_program_t<program_t> dual_fill;
+        dual_view_program_t<text_program_t> dual_text;
         fullbg_program_t fullbg;
         noise_program_t noise;
         gradient_program_t gradient;
@@ -114,13 +282,22 @@ struct core
     } prog;
 
     GLint render_quality = gl::LINEAR;
-    std::unique_ptr<const render_buffer_t> render_buffer_masked;
+    bool instancing = false;
+    mutable render_target_pool render_targets;
+    render_target render_buffer_masked;
     idle::point_t draw_size{0, 0};
     buffer_size screen_size{0, 0}, viewport_size{0, 0};
     math::point2<GLfloat> translate_vector;
 
     std::array<GLfloat, 8> draw_bounds_verts;
 
+    // Instance attributes of the mask and the normal view for dual view programs
+    std::array<GLfloat, 2 * dual_view_program_t<program_t>::view_stride> dual_views;
+
+    mutable stream_buffer stream;
+    mutable gpu_timer timer;
+    program_builder builder;
+
     struct
     {
         std::optional<fonts::font_t> regular, title;
@@ -135,13 +312,13 @@ struct core
         1, 1
     };
 
-    void copy_projection_matrix(const idle::mat4x4_noopt_t&) const noexcept;
+    void copy_projection_matrix(const idle::mat4x4_noopt_t&) noexcept;
 
     bool setup_graphics() noexcept;
 
     bool resize(buffer_size window_size) noexcept;
 
-    std::unique_ptr<const render_buffer_t> new_render_buffer(unsigned divider = 1) const noexcept;
+    render_target new_render_buffer(unsigned divider = 1) const noexcept;
 
     void clean() noexcept;
 
@@ -150,6 +327,55 @@ struct core
     void view_mask() const noexcept;
 
     void view_distortion() const noexcept;
+
+    // The whole masked buffer, both views at once
+    void view_dual() const noexcept;
+
+    // Draws the same geometry into the mask and the normal view with a dual view program.
+    // With instancing it is submitted once, otherwise `draw` is replayed into each viewport.
+    template<typename Program, typename Draw>
+    void draw_views(const Program& program, const Draw& draw) const noexcept
+    {
+        program.use();
+
+        if (instancing)
+        {
+            view_dual();
+            program.begin_views(dual_views.data());
+            draw();
+            program.end_views();
+        }
+        else
+        {
+            view_mask();
+            program.select_view(true);
+            draw();
+            program.select_view(false);
+        }
+
+        view_normal();
+
+        if (!instancing)
+            draw();
+    }
+};
+
+// Dual filter (Kawase) blur: halves the source `levels` times and scales it back up to half of its size
+class dual_blur
+{
+    std::vector<render_target> chain;
+
+public:
+    dual_blur() noexcept = default;
+
+    dual_blur(const core& gl, buffer_size source_size, unsigned levels) noexcept;
+
+    // Offset widens the taps at every level, zero leaves only the blur of the downsampling
+    const render_buffer_t& apply(const core& gl, const render_buffer_t& source, GLfloat offset) const noexcept;
+
+    const render_buffer_t& result() const noexcept;
+
+    void reset() noexcept;
 };
 
 
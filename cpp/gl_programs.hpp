@@ -18,6 +18,7 @@
 */
 
 #pragma once
+#include <array>
 #include <math_defines.hpp>
 
 namespace graphics
@@ -42,16 +43,134 @@ public:
     GLuint get() const noexcept;
 };
 
+// GL buffer object that can be safely dropped from any thread;
+// deletion is deferred until clean_trash() is called with a current context.
+struct vertex_buffer
+{
+private:
+    GLuint value = 0;
+    unsigned generation = 0;
+
+public:
+    vertex_buffer() noexcept = default;
+
+    vertex_buffer(const vertex_buffer&) = delete;
+    vertex_buffer& operator=(const vertex_buffer&) = delete;
+
+    vertex_buffer(vertex_buffer&&) noexcept;
+    vertex_buffer& operator=(vertex_buffer&&) noexcept;
+
+    ~vertex_buffer() noexcept;
+
+    // False if never uploaded or if the context it was uploaded to is gone
+    bool is_current() const noexcept;
+
+    // Leaves the buffer bound to GL_ARRAY_BUFFER
+    void upload(const void* data, GLsizeiptr size, GLenum usage = gl::STATIC_DRAW) noexcept;
+
+    void bind() const noexcept;
+
+    static void unbind() noexcept;
+
+    static void clean_trash() noexcept;
+
+    static void invalidate_context() noexcept;
+};
+
+// Two floats per texel, sampled with NEAREST by vertex shaders; follows the lifetime rules of vertex_buffer.
+// Lives on a texture unit of its own, out of the way of state::bind_texture
+struct table_texture
+{
+private:
+    GLuint value = 0;
+    unsigned generation = 0;
+
+public:
+    table_texture() noexcept = default;
+
+    table_texture(const table_texture&) = delete;
+    table_texture& operator=(const table_texture&) = delete;
+
+    table_texture(table_texture&&) noexcept;
+    table_texture& operator=(table_texture&&) noexcept;
+
+    ~table_texture() noexcept;
+
+    bool is_current() const noexcept;
+
+    // Both leave the texture bound to unit and texture unit 0 active
+    void upload(const GLfloat* data, GLsizei width, GLsizei height, GLenum unit) noexcept;
+
+    void bind(GLenum unit) const noexcept;
+};
+
+struct call_counter
+{
+    unsigned issued = 0, skipped = 0;
+};
+
+struct state_stats
+{
+    call_counter programs, textures, uniforms;
+};
+
+// Shadow copy of the GL state shared by all programs; calls that would not change anything are skipped.
+// Everything is drawn from texture unit 0, so a single binding is tracked.
+namespace state
+{
+
+void use_program(GLuint program) noexcept;
+
+void bind_texture(GLuint texture) noexcept;
+
+// Whenever textures are bound or deleted behind the cache's back
+void forget_texture() noexcept;
+
+void forget() noexcept;
+
+void next_frame() noexcept;
+
+const state_stats& last_frame() noexcept;
+
+}  // namespace state
+
+class program_builder;
+
 struct program_t
 {
     GLuint program_id = 0;
 
 private:
+    friend class program_builder;
+
+    // Set while the program is still being linked, the first use() finishes it
+    mutable program_builder* pending = nullptr;
+    std::array<GLfloat, 16> projection{};
+    bool projection_known = false;
+
     GLuint position_handle = 0;
     GLint model_handle = 0,
           view_handle = 0,
           color_handle = 0;
 
+    struct uniform_shadow
+    {
+        std::array<GLfloat, 16> model{}, view{};
+        std::array<GLfloat, 4> color{};
+        bool model_known = false, view_known = false, color_known = false;
+    };
+
+    mutable uniform_shadow shadow;
+
+    void upload_model(const GLfloat *f) const noexcept;
+
+    void upload_view(const GLfloat *f) const noexcept;
+
+    void upload_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a) const noexcept;
+
+protected:
+    mutable GLsizei instances = 0;
+
 public:
     void set_transform(const idle::mat4x4_t& f) const noexcept;
 
@@ -69,7 +188,15 @@ public:
 
     void set_color(const idle::color_t& c, float custom_alpha) const noexcept;
 
-    void position_vertex(const GLfloat *f) const noexcept;
+    // Kept until the program is ready when it is still being linked
+    void set_projection(const idle::mat4x4_noopt_t& f) noexcept;
+
+    bool is_ready() const noexcept;
+
+    void position_vertex(const GLfloat *f, GLsizei stride = 0) const noexcept;
+
+    // Instanced while the program replicates its draws into several views
+    void draw_arrays(GLenum mode, GLint first, GLsizei count) const noexcept;
 
     void use() const noexcept;
 
@@ -82,7 +209,7 @@ private:
     GLuint texture_position_handle = 0;
 
 public:
-    void texture_vertex(const GLfloat *f) const noexcept;
+    void texture_vertex(const GLfloat *f, GLsizei stride = 0) const noexcept;
 
     void prepare() noexcept;
 };
@@ -120,7 +247,7 @@ public:
 
     void set_secondary_color(const idle::color_t& c, float alpha) const noexcept;
 
-    void interpolation_vertex(const GLfloat *f) const noexcept;
+    void interpolation_vertex(const GLfloat *f, GLsizei stride = 0) const noexcept;
 };
 
 struct double_base_program_t
@@ -142,7 +269,7 @@ struct double_solid_program_t : program_t, double_base_program_t
     void prepare() noexcept;
 };
 
-struct double_vertex_program_t : textured_program_t, double_base_program_t
+struct texture_shift_base_program_t
 {
 private:
     GLint face_shift_handle = 0, internal_shift_handle = 0, multiplier_handle = 0;
@@ -154,16 +281,97 @@ public:
 
     void set_texture_mult(const idle::point_t pt) const noexcept;
 
+    void prepare_headless(GLuint prog) noexcept;
+};
+
+struct double_vertex_program_t : textured_program_t, double_base_program_t, texture_shift_base_program_t
+{
+    void prepare() noexcept;
+};
+
+// Keyframes come from a table texture, a row per keyframe and a column per vertex, so every instance
+// interpolates between its own pair of rows; attr_pos only holds the column.
+// Per-instance attribute arrays are only enabled between begin_instances and end_instances.
+// Their locations are pinned past those of every other program, so that disabling them leaves them be
+struct instanced_double_program_t : textured_program_t, texture_shift_base_program_t
+{
+    static constexpr GLuint instance_location = 8, keyframes_location = 9;
+    static constexpr GLenum keyframes_unit = gl::TEXTURE1;
+
+    // Per instance: translation xy, interpolation, keyframe rows (from, to), texture shift x
+    static constexpr std::size_t instance_stride = 6;
+
+private:
+    GLint keyframes_size_handle = 0;
+
+public:
+    void set_keyframes_size(idle::point_t size) const noexcept;
+
+    void instance_vertex(const GLfloat *f) const noexcept;
+
+    void begin_instances() const noexcept;
+
+    void end_instances() const noexcept;
+
     void prepare() noexcept;
 };
 
 struct text_program_t : textured_program_t
 {
 private:
-    GLint font_offset_handle = 0;
+    GLuint vertex_color_handle = 0;
 
 public:
-    void set_text_offset(idle::point_t offset) const noexcept;
+    void color_vertex(const GLfloat *f, GLsizei stride = 0) const noexcept;
+
+    void prepare() noexcept;
+};
+
+// Reads distance field glyphs, widths are in distance units where 0.5 covers the whole spread
+struct sdf_text_program_t : text_program_t
+{
+private:
+    GLint outline_color_handle = 0,
+          glow_color_handle = 0,
+          smoothing_handle = 0,
+          outline_width_handle = 0,
+          glow_width_handle = 0;
+
+public:
+    // Half the width of the antialiased edge, best matched to one screen pixel
+    void set_smoothing(GLfloat s) const noexcept;
+
+    void set_outline(const idle::color_t& c, GLfloat width) const noexcept;
+
+    void set_glow(const idle::color_t& c, GLfloat width) const noexcept;
+
+    void prepare() noexcept;
+};
+
+// Replicates every draw into the mask and the normal view. Between begin_views and end_views
+// both views are drawn at once as two instances over the whole masked buffer;
+// otherwise select_view picks the one the current viewport belongs to.
+template<typename Base>
+struct dual_view_program_t : Base
+{
+    static constexpr GLuint view_location = 6, view_mask_location = 7;
+
+    // Per view: scale xy, offset xy, mask flag
+    static constexpr std::size_t view_stride = 5;
+
+private:
+    GLint mask_color_handle = 0;
+
+public:
+    void set_mask_color(const idle::color_t& c) const noexcept;
+
+    void set_mask_color(const idle::color_t& c, float custom_alpha) const noexcept;
+
+    void begin_views(const GLfloat *f) const noexcept;
+
+    void end_views() const noexcept;
+
+    void select_view(bool mask) const noexcept;
 
     void prepare() noexcept;
 };
@@ -172,11 +380,13 @@ struct fullbg_program_t : program_t
 {
 private:
     GLuint offset_handle = 0, resolution_handle = 0;
+    idle::point_t resolution{ 1, 1 };
 
 public:
     void set_offset(GLfloat x) const noexcept;
 
-    void set_resolution(idle::point_t res) const noexcept;
+    // Binds the program, deferred until the program is ready
+    void set_resolution(idle::point_t res) noexcept;
 
     void prepare() noexcept;
 };
@@ -0,0 +1,253 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <log.hpp>
+#include <idle/gl_programs.hpp>
+
+namespace idle::glass
+{
+
+template<typename Program, typename Tables>
+struct baked_program;
+
+template<typename Program, typename Tables, typename Keyframes>
+struct keyframe_program;
+
+// Keeps a copy of constexpr tables (results of glass::make, skin textures) in a static vertex buffer,
+// so the client pointers handed out by the drawables can be replaced with buffer offsets.
+template<std::size_t Count>
+class baked_tables
+{
+    struct region
+    {
+        const void* data;
+        std::size_t size;
+    };
+
+    std::array<region, Count> regions;
+    graphics::vertex_buffer buffer;
+
+public:
+    template<typename...Tables>
+    explicit baked_tables(const Tables&...tables) noexcept
+        : regions{ region{ &tables, sizeof(Tables) }... }
+    {
+    }
+
+    // Uploads on first use and after the context was lost, leaves the buffer bound
+    void bind() noexcept
+    {
+        if (buffer.is_current())
+        {
+            buffer.bind();
+            return;
+        }
+
+        std::size_t total = 0;
+        for (const auto& it : regions)
+            total += it.size;
+
+        auto copy = std::make_unique<std::byte[]>(total);
+        std::size_t offset = 0;
+        for (const auto& it : regions)
+        {
+            std::memcpy(copy.get() + offset, it.data, it.size);
+            offset += it.size;
+        }
+
+        LOGD("Uploading %zu bytes of baked meshes", total);
+        buffer.upload(copy.get(), static_cast<GLsizeiptr>(total));
+    }
+
+    const GLfloat* translate(const GLfloat* ptr) const noexcept
+    {
+        const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+        std::uintptr_t offset = 0;
+
+        for (const auto& it : regions)
+        {
+            const auto begin = reinterpret_cast<std::uintptr_t>(it.data);
+
+            if (address >= begin && address < begin + it.size)
+                return reinterpret_cast<const GLfloat*>(offset + (address - begin));
+
+            offset += it.size;
+        }
+
+        LOGE("Vertex data at %p was not baked", static_cast<const void*>(ptr));
+        return nullptr;
+    }
+
+    template<typename Program>
+    baked_program<Program, baked_tables> wrap(const Program& program) const noexcept
+    {
+        return { program, *this };
+    }
+};
+
+template<typename...Tables>
+baked_tables(const Tables&...) -> baked_tables<sizeof...(Tables)>;
+
+// Stands in for a double_vertex_program_t while drawing from a bound baked_tables buffer
+template<typename Program, typename Tables>
+struct baked_program
+{
+    const Program& program;
+    const Tables& tables;
+
+    void position_vertex(const GLfloat *f) const noexcept
+    {
+        program.position_vertex(tables.translate(f));
+    }
+
+    void destination_vertex(const GLfloat *f) const noexcept
+    {
+        program.destination_vertex(tables.translate(f));
+    }
+
+    void texture_vertex(const GLfloat *f) const noexcept
+    {
+        program.texture_vertex(tables.translate(f));
+    }
+
+    void set_texture_shift_internal(const point_t pt) const noexcept
+    {
+        program.set_texture_shift_internal(pt);
+    }
+
+};
+
+// Every keyframe of an animation table (frames per direction) as a row of a table texture.
+// Frame meshes share the layout of their skin, so a vertex is found by its offset within the skin
+template<typename Skin>
+class baked_keyframes
+{
+public:
+    static constexpr std::size_t columns = sizeof(Skin) / sizeof(point_t);
+
+    // Bake along with the meshes, these stand in for the vertex positions
+    static constexpr auto indices = []
+    {
+        std::array<point_t, columns> out{};
+        for (std::size_t i = 0; i < columns; ++i)
+            out[i] = { static_cast<float>(i), 0 };
+        return out;
+    }();
+
+private:
+    const Skin& skin;
+    const std::byte* frames;
+    std::size_t frame_size;
+    GLsizei rows;
+    graphics::table_texture texture;
+
+public:
+    template<typename Frame, std::size_t Count, std::size_t Directions>
+    baked_keyframes(const std::array<std::array<Frame, Count>, Directions>& table, const Skin& s) noexcept
+        : skin{ s },
+        frames{ reinterpret_cast<const std::byte*>(&table) },
+        frame_size{ sizeof(Frame) },
+        rows{ static_cast<GLsizei>(Count * Directions) }
+    {
+        static_assert(sizeof(typename Frame::drawable_t) == sizeof(Skin));
+    }
+
+    // Row of a frame, as picked by an instance
+    static constexpr GLfloat row(const std::size_t direction, const std::size_t frame, const std::size_t count) noexcept
+    {
+        return static_cast<GLfloat>(direction * count + frame);
+    }
+
+    point_t size() const noexcept
+    {
+        return { static_cast<float>(columns), static_cast<float>(rows) };
+    }
+
+    // Uploads on first use and after the context was lost
+    void bind(const GLenum unit) noexcept
+    {
+        if (texture.is_current())
+        {
+            texture.bind(unit);
+            return;
+        }
+
+        constexpr std::size_t row_size = columns * sizeof(point_t);
+        auto copy = std::make_unique<std::byte[]>(row_size * rows);
+        for (GLsizei i = 0; i < rows; ++i)
+            std::memcpy(copy.get() + i * row_size, frames + i * frame_size, row_size);
+
+        LOGD("Uploading %d keyframes of %zu vertices", rows, columns);
+        texture.upload(reinterpret_cast<const GLfloat*>(copy.get()), static_cast<GLsizei>(columns), rows, unit);
+    }
+
+    const GLfloat* index_of(const GLfloat* texture_vertex) const noexcept
+    {
+        const auto offset = static_cast<std::size_t>(texture_vertex - reinterpret_cast<const GLfloat*>(&skin));
+        return reinterpret_cast<const GLfloat*>(&indices[offset / 2]);
+    }
+
+    template<typename Program, typename Tables>
+    keyframe_program<Program, Tables, baked_keyframes> wrap(const Program& program, const Tables& tables, const GLsizei instances) const noexcept
+    {
+        return { program, tables, *this, instances };
+    }
+};
+
+// Stands in for an instanced_double_program_t, the mesh pointers only tell which columns to read
+template<typename Program, typename Tables, typename Keyframes>
+struct keyframe_program
+{
+    const Program& program;
+    const Tables& tables;
+    const Keyframes& keyframes;
+    GLsizei instances;
+
+    void position_vertex(const GLfloat *) const noexcept
+    {
+    }
+
+    void destination_vertex(const GLfloat *) const noexcept
+    {
+    }
+
+    void texture_vertex(const GLfloat *f) const noexcept
+    {
+        program.texture_vertex(tables.translate(f));
+        program.position_vertex(tables.translate(keyframes.index_of(f)));
+    }
+
+    void set_texture_shift_internal(const point_t pt) const noexcept
+    {
+        program.set_texture_shift_internal(pt);
+    }
+
+    void draw_strip(const GLsizei count) const noexcept
+    {
+        gl::DrawArraysInstanced(gl::TRIANGLE_STRIP, 0, count, instances);
+    }
+};
+
+}  // namespace idle::glass
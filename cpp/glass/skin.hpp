@@ -53,6 +53,22 @@ constexpr auto skew_index(const Painter& paint_vertex, const Source& key_frame_v
     };
 }
 
+idle_check_method_boilerplate(draw_strip);
+
+// Programs may take over the draw call, e.g. to issue it once per instance
+template<typename Program>
+void draw_strip(const Program& prog, const GLsizei count) noexcept
+{
+    if constexpr(idle_has_method(Program, draw_strip))
+    {
+        prog.draw_strip(count);
+    }
+    else
+    {
+        gl::DrawArrays(gl::TRIANGLE_STRIP, 0, count);
+    }
+}
+
 template<auto Size>
 constexpr float average_depth(const std::array<point_3d_t, Size>& input) noexcept
 {
@@ -89,7 +105,7 @@ private:
         prog.position_vertex(reinterpret_cast<const GLfloat*>(mesh[index].data()));
         prog.destination_vertex(reinterpret_cast<const GLfloat*>(another.mesh[index].data()));
         prog.texture_vertex(reinterpret_cast<const GLfloat*>(texture[index].data()));
-        gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
+        meta::draw_strip(prog, 4);
     }
 
 public:
@@ -119,7 +135,7 @@ struct drawable_strip
         prog.position_vertex(reinterpret_cast<const GLfloat*>(mesh.data()));
         prog.destination_vertex(reinterpret_cast<const GLfloat*>(another.mesh.data()));
         prog.texture_vertex(reinterpret_cast<const GLfloat*>(texture.data()));
-        gl::DrawArrays(gl::TRIANGLE_STRIP, 0, Size);
+        meta::draw_strip(prog, Size);
     }
 };
 
@@ -887,6 +903,11 @@ public:
         }
     }
 
+    constexpr const std::array<unsigned char, Size>& order() const noexcept
+    {
+        return table;
+    }
+
     template<typename Program, typename Drawable, typename...Extra>
     void draw(const Program& program,
             const Drawable& drawable,
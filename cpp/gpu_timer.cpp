@@ -0,0 +1,183 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+#include <log.hpp>
+#include "gpu_timer.hpp"
+
+namespace graphics
+{
+
+void gpu_timer::setup() noexcept
+{
+    for (auto& it : frames)
+        it.clear();
+
+    spare_queries.clear();
+    passes.clear();
+    results = {};
+
+#ifdef __ANDROID__
+    const auto extensions = reinterpret_cast<const char*>(gl::GetString(gl::EXTENSIONS));
+    enabled = extensions && std::strstr(extensions, "GL_EXT_disjoint_timer_query")
+#else
+    enabled = gl::sys::IsVersionGEQ(3, 3)
+#endif
+        && gl::GenQueries && gl::DeleteQueries && gl::BeginQuery && gl::EndQuery
+        && gl::GetQueryObjectuiv && gl::GetQueryObjectui64v;
+
+    LOGD("GPU timer queries are %s", enabled ? "available" : "unavailable");
+}
+
+void gpu_timer::clean() noexcept
+{
+    if (!enabled)
+        return;
+
+    if (!passes.empty())
+    {
+        gl::EndQuery(gl::TIME_ELAPSED);
+        passes.clear();
+    }
+
+    for (auto& frame : frames)
+    {
+        for (const auto& it : frame)
+            spare_queries.push_back(it.query);
+
+        frame.clear();
+    }
+
+    if (!spare_queries.empty())
+    {
+        gl::DeleteQueries(static_cast<GLsizei>(spare_queries.size()), spare_queries.data());
+        spare_queries.clear();
+    }
+}
+
+void gpu_timer::start(const gpu_pass pass) noexcept
+{
+    GLuint query = 0;
+
+    if (spare_queries.empty())
+    {
+        gl::GenQueries(1, &query);
+    }
+    else
+    {
+        query = spare_queries.back();
+        spare_queries.pop_back();
+    }
+
+    gl::BeginQuery(gl::TIME_ELAPSED, query);
+    frames[current].push_back({ query, pass });
+}
+
+void gpu_timer::begin(const gpu_pass pass) noexcept
+{
+    if (!enabled)
+        return;
+
+    if (!passes.empty())
+        gl::EndQuery(gl::TIME_ELAPSED);
+
+    passes.push_back(pass);
+    start(pass);
+}
+
+void gpu_timer::end() noexcept
+{
+    if (!enabled || passes.empty())
+        return;
+
+    gl::EndQuery(gl::TIME_ELAPSED);
+    passes.pop_back();
+
+    if (!passes.empty())
+        start(passes.back());
+}
+
+void gpu_timer::next_frame() noexcept
+{
+    if (!enabled)
+        return;
+
+    current = (current + 1) % frames_in_flight;
+    auto& frame = frames[current];
+
+    if (frame.empty())
+        return;
+
+    // Queries finish in order, the last one being ready means all of them are
+    GLuint available = 0;
+    gl::GetQueryObjectuiv(frame.back().query, gl::QUERY_RESULT_AVAILABLE, &available);
+
+    GLint disjoint = 0;
+#ifdef __ANDROID__
+    gl::GetIntegerv(gl::GPU_DISJOINT, &disjoint);
+#endif
+
+    if (available && !disjoint)
+    {
+        results.milliseconds = {};
+
+        for (const auto& it : frame)
+        {
+            GLuint64 nanoseconds = 0;
+            gl::GetQueryObjectui64v(it.query, gl::QUERY_RESULT, &nanoseconds);
+            results.milliseconds[static_cast<std::size_t>(it.pass)] += static_cast<float>(nanoseconds) / 1e6f;
+        }
+        results.valid = true;
+    }
+    else
+    {
+        ++results.dropped_frames;
+    }
+
+    for (const auto& it : frame)
+        spare_queries.push_back(it.query);
+
+    frame.clear();
+}
+
+bool gpu_timer::is_enabled() const noexcept
+{
+    return enabled;
+}
+
+const gpu_pass_times& gpu_timer::last_frame() const noexcept
+{
+    return results;
+}
+
+const char* gpu_timer::name(const gpu_pass pass) noexcept
+{
+    switch (pass)
+    {
+        case gpu_pass::scene: return "scene";
+        case gpu_pass::noise: return "noise";
+        case gpu_pass::blur: return "blur";
+        case gpu_pass::composite: return "comp";
+        case gpu_pass::overlay: return "ovl";
+        default: return "?";
+    }
+}
+
+}  // namespace graphics
@@ -0,0 +1,109 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "platform/opengl_core_adaptive.hpp"
+
+namespace graphics
+{
+
+enum class gpu_pass : uint8_t
+{
+    scene,
+    noise,
+    blur,
+    composite,
+    overlay,
+    count
+};
+
+constexpr auto gpu_pass_count = static_cast<std::size_t>(gpu_pass::count);
+
+struct gpu_pass_times
+{
+    std::array<float, gpu_pass_count> milliseconds {};
+    unsigned dropped_frames = 0;
+    bool valid = false;
+};
+
+// Time elapsed on the GPU per pass, read back a couple of frames late so that the CPU never waits on a query.
+// Passes may nest, the time is attributed to the innermost one.
+class gpu_timer
+{
+    static constexpr unsigned frames_in_flight = 2;
+
+    struct segment
+    {
+        GLuint query;
+        gpu_pass pass;
+    };
+
+    std::array<std::vector<segment>, frames_in_flight> frames;
+    std::vector<GLuint> spare_queries;
+    std::vector<gpu_pass> passes;
+    gpu_pass_times results;
+    unsigned current = 0;
+    bool enabled = false;
+
+    void start(gpu_pass pass) noexcept;
+
+public:
+    void setup() noexcept;
+
+    void clean() noexcept;
+
+    void begin(gpu_pass pass) noexcept;
+
+    void end() noexcept;
+
+    // Collects the oldest frame in flight, to be called outside of any pass
+    void next_frame() noexcept;
+
+    bool is_enabled() const noexcept;
+
+    const gpu_pass_times& last_frame() const noexcept;
+
+    static const char* name(gpu_pass pass) noexcept;
+};
+
+class gpu_scope
+{
+    gpu_timer& timer;
+
+public:
+    gpu_scope(gpu_timer& t, const gpu_pass pass) noexcept
+        : timer{ t }
+    {
+        timer.begin(pass);
+    }
+
+    ~gpu_scope() noexcept
+    {
+        timer.end();
+    }
+
+    gpu_scope(const gpu_scope&) = delete;
+    gpu_scope& operator=(const gpu_scope&) = delete;
+};
+
+}  // namespace graphics
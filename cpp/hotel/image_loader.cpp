@@ -17,72 +17,110 @@
     along with Idle. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <cstring>
 #include "image_loader.hpp"
 
 namespace idle::hotel::garment
 {
 
-pool::pool() noexcept
+unsigned pool::default_worker_count() noexcept
 {
-    start_worker();
+    // Uploads are serialized on the GL thread anyway, a couple of decoders are plenty
+    return std::clamp(std::thread::hardware_concurrency() / 2, 1u, 3u);
 }
 
-void pool::start_worker() noexcept
+pool::pool(const unsigned count) noexcept
+    : workers{ std::make_unique<room_service[]>(count) },
+    worker_count{ count }
 {
-    worker.start([this]()
+    start_workers();
+}
+
+void pool::work(const room_service& worker) noexcept
+{
+    while (worker.is_active())
     {
-        while (worker.is_active())
-        {
-            std::unique_lock<std::mutex> lock(mutex);
-            cond_variable.wait(lock, [this]() { return queue.size() || !worker.is_active(); });
+        std::unique_lock<std::mutex> lock(mutex);
+        cond_variable.wait(lock, [this, &worker]() { return queue.size() || !worker.is_active(); });
+
+        if (!worker.is_active())
+            break;
 
-            for (const auto [fn, out, q] : queue)
+        const auto top = std::max_element(queue.begin(), queue.end(),
+                [](const item& a, const item& b) { return a.urgency < b.urgency; });
+        const item request = *top;
+        queue.erase(top);
+
+        // Requests for the same picture still waiting in the queue are answered by this load
+        std::vector<images::texture*> outs{ request.out };
+        std::erase_if(queue, [&request, &outs](const item& it)
+            {
+                if (it.filename != request.filename && ::strcmp(it.filename, request.filename) != 0)
+                    return false;
+                outs.push_back(it.out);
+                return true;
+            });
+        lock.unlock();
+
+        db.request(request.filename, request.quality, [outs = std::move(outs)](const images::texture& tex)
             {
-                *out = db.load_from_assets(fn, q);
-            }
-            queue.clear();
-        }
-    });
+                for (auto out : outs)
+                    *out = tex;
+            });
+    }
 }
 
-void pool::load_image(const char * filename, images::texture& out, GLint quality) noexcept
+void pool::start_workers() noexcept
+{
+    for (unsigned i = 0; i < worker_count; ++i)
+    {
+        auto& worker = workers[i];
+        worker.start([this, &worker]() { work(worker); });
+    }
+}
+
+void pool::load_image(const char * filename, images::texture& out, GLint quality, priority urgency) noexcept
 {
     {
         std::lock_guard lock{mutex};
-        queue.push_back(item{filename, &out, quality});
+        queue.push_back(item{filename, &out, quality, urgency});
     }
     cond_variable.notify_one();
 }
 
 pool::~pool() noexcept
 {
-    kill_worker();
+    kill_workers();
 }
 
-void pool::kill_worker() noexcept
+void pool::kill_workers() noexcept
 {
     {
         std::lock_guard lock{mutex};
-        worker.set_active(false);
+        queue.clear();
+        for (unsigned i = 0; i < worker_count; ++i)
+            workers[i].set_active(false);
     }
-    cond_variable.notify_one();
-    worker.stop();
+    cond_variable.notify_all();
+
+    for (unsigned i = 0; i < worker_count; ++i)
+        workers[i].stop();
 }
 
 void loader::load_queued_images() noexcept
 {
-    pictures.db.load_topmost_queued_picture();
+    pictures.db.load_queued_pictures();
 }
 
 void loader::start_workers() noexcept
 {
-    pictures.start_worker();
+    pictures.start_workers();
 }
 
 void loader::kill_workers() noexcept
 {
-    pictures.kill_worker();
+    pictures.kill_workers();
 }
 
 }  // namespace idle::hotel::garment
-
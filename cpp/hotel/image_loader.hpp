@@ -20,6 +20,8 @@
 #pragma once
 #include <mutex>
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <utility>
 #include <math_defines.hpp>
@@ -29,6 +31,13 @@
 namespace idle::hotel::garment
 {
 
+// Pictures on screen right away go ahead of the rest, equals keep their order
+enum class priority : std::uint8_t
+{
+    deferred,
+    visible
+};
+
 class pool
 {
     struct item
@@ -36,25 +45,31 @@ class pool
         const char* filename;
         images::texture* out;
         GLint quality;
+        priority urgency;
     };
 
     std::mutex mutex;
     std::condition_variable cond_variable;
-    room_service worker;
+    std::unique_ptr<room_service[]> workers;
+    unsigned worker_count;
     std::vector<item> queue;
 
+    void work(const room_service& worker) noexcept;
+
 public:
     images::database db;
 
-    pool() noexcept;
+    static unsigned default_worker_count() noexcept;
+
+    explicit pool(unsigned worker_count = default_worker_count()) noexcept;
 
     ~pool() noexcept;
 
-    void load_image(const char * filename, images::texture& out, GLint quality = gl::NEAREST) noexcept;
+    void load_image(const char * filename, images::texture& out, GLint quality = gl::NEAREST, priority urgency = priority::deferred) noexcept;
 
-    void start_worker() noexcept;
+    void start_workers() noexcept;
 
-    void kill_worker() noexcept;
+    void kill_workers() noexcept;
 };
 
 struct loader
@@ -403,15 +403,18 @@ void room::draw(const graphics::core& gl) const noexcept
 
     const auto fadeout_alpha_sine = std::sin(std::max<float>(thing.alpha + 1.f, 2.f) * math::tau_4) + 1.f;
 
-    gl.view_mask();
+    {
+        const graphics::gpu_scope pass{ gl.timer, graphics::gpu_pass::noise };
+        gl.view_mask();
 
-    draw_dim_noise(gl.prog.noise,
-            gl.draw_size,
-            *reinterpret_cast<const point_t*>(noise_seed.data()),
-            alpha_sine,
-            fadeout_alpha_sine);
+        draw_dim_noise(gl.prog.noise,
+                gl.draw_size,
+                *reinterpret_cast<const point_t*>(noise_seed.data()),
+                alpha_sine,
+                fadeout_alpha_sine);
 
-    gl.view_normal();
+        gl.view_normal();
+    }
 
     if (thing.alpha > .8f && fadeout_alpha_sine > .7f)
     {
@@ -24,6 +24,7 @@
 #include "room_model.hpp"
 
 #include <idle/glass/glass.hpp>
+#include <idle/glass/baked.hpp>
 #include <guard.hpp>
 #include "../game/objects.hpp"
 
@@ -169,6 +170,12 @@ constexpr auto human_skin = glass::paint::human_mesh.texture();
 
 constexpr auto& drawn_model = walking_lines;
 
+auto& baked_walking_paint() noexcept
+{
+    static glass::baked_tables baked{ walking_paint, human_skin };
+    return baked;
+}
+
 }  // namespace
 
 template<typename Model, typename Paint>
@@ -193,7 +200,6 @@ void room::draw_model(const graphics::core& gl, const Model& model, const Paint&
     if (show_skin || show_blobs)
     {
         gl.prog.double_normal.use();
-        gl::ActiveTexture(gl::TEXTURE0);
 
         gl.prog.double_normal.set_interpolation(anim.interpolation);
         gl.prog.double_normal.set_transform(scale_mat);
@@ -201,39 +207,45 @@ void room::draw_model(const graphics::core& gl, const Model& model, const Paint&
         gl.prog.double_normal.set_color({ 1, 1, 1 });
         const bool data = true;
 
+        auto& baked = baked_walking_paint();
+        baked.bind();
+        const auto baked_prog = baked.wrap(gl.prog.double_normal);
+
         if (show_blobs)
         {
-            gl::BindTexture(gl::TEXTURE_2D, debug_texture.id);
+            graphics::state::bind_texture(debug_texture.id);
             gl.prog.double_normal.set_texture_mult(debug_texture.area);
-            gl.prog.double_normal.set_texture_shift({0, 0});
+            gl.prog.double_normal.set_texture_shift(debug_texture.offset);
             paint[anim.source % model.size()].draw(
-                    gl.prog.double_normal,
+                    baked_prog,
                     paint[anim.dest % model.size()],
                     human_skin, data);
         }
 
         if (show_skin)
         {
-            gl::BindTexture(gl::TEXTURE_2D, char_texture.id);
+            graphics::state::bind_texture(char_texture.id);
             gl.prog.double_normal.set_texture_mult(char_texture.area / 8.f);
-            gl.prog.double_normal.set_texture_shift({facing / static_cast<float>(drawn_model.size()), 0});
+            gl.prog.double_normal.set_texture_shift(char_texture.offset + point_t{facing / static_cast<float>(drawn_model.size()) * char_texture.area.x, 0});
             paint[anim.source % model.size()].draw(
-                    gl.prog.double_normal,
+                    baked_prog,
                     paint[anim.dest % model.size()],
                     human_skin, data);
         }
 
         if (show_blobs)
         {
-            gl::BindTexture(gl::TEXTURE_2D, debug_texture.id);
+            graphics::state::bind_texture(debug_texture.id);
             gl.prog.double_normal.set_texture_mult(debug_texture.area);
-            gl.prog.double_normal.set_texture_shift({0, 0});
+            gl.prog.double_normal.set_texture_shift(debug_texture.offset);
             gl.prog.double_normal.set_color({ 1, 1, 1, .3f });
             paint[anim.source % model.size()].draw(
-                    gl.prog.double_normal,
+                    baked_prog,
                     paint[anim.dest % model.size()],
                     human_skin, data);
         }
+
+        graphics::vertex_buffer::unbind();
     }
 
     if (show_bones)
@@ -330,8 +342,8 @@ std::optional<keyring::variant> room::step(const pointer_wrapper& pointer) noexc
 
                 case function::reload_images:
                     pictures.db.destroy_textures();
-                    pictures.load_image("debug_tex.png", debug_texture);
-                    pictures.load_image("octavia_tex.png", char_texture, gl::NEAREST);
+                    pictures.load_image(config::debug_texture_asset, debug_texture);
+                    pictures.load_image(config::octavia_texture_asset, char_texture, gl::NEAREST, garment::priority::visible);
                     break;
 
                 default:
@@ -350,8 +362,8 @@ void room::on_resize(const point_t screen_size) noexcept
 
 room::room() noexcept
 {
-    pictures.load_image("debug_tex.png", debug_texture);
-    pictures.load_image("octavia_tex.png", char_texture, gl::NEAREST);
+    pictures.load_image(config::debug_texture_asset, debug_texture);
+    pictures.load_image(config::octavia_texture_asset, char_texture, gl::NEAREST, garment::priority::visible);
 }
 
 }  // namespace idle::hotel::model
@@ -26,6 +26,7 @@
 #include "gui.hpp"
 #include "keys.hpp"
 #include "image_loader.hpp"
+#include "../assets_config.hpp"
 
 namespace idle::hotel::model
 {
@@ -79,10 +80,10 @@ struct model_button : gui::shapes::button<gui::positions::edge_hugger<X, Y>, wid
             }
         }();
 
-        gl.prog.text.use();
-        gl.prog.text.set_color(scheme.second);
+        gl.prog.sdf_text.use();
+        gl.prog.sdf_text.set_color(scheme.second);
 
-        draw_text<text_align::center, text_align::center>(*gl.fonts.regular, gl.prog.text, scheme.first, this->pos, height *.85f);
+        draw_text<text_align::center, text_align::center>(*gl.fonts.regular, gl.prog.sdf_text, scheme.first, this->pos, height *.85f);
     }
 
     auto trigger() const noexcept -> function
@@ -93,6 +94,8 @@ struct model_button : gui::shapes::button<gui::positions::edge_hugger<X, Y>, wid
 
 struct room : garment::loader
 {
+    static constexpr const char * manifest[] { config::debug_texture_asset, config::octavia_texture_asset };
+
     template<function Id, int X, int Y = -16>
     using control_button = model_button<Id, X, Y, 39, 22>;
 
@@ -19,8 +19,10 @@
 
 #include <random>
 #include <cmath>
+#include <cstddef>
 #include <algorithm>
 #include <utility>
+#include <optional>
 #include <idle/drawable.hpp>
 #include "room_stage.hpp"
 #include "../draw_text.hpp"
@@ -30,6 +32,105 @@
 namespace idle::hotel::stage
 {
 
+namespace
+{
+
+struct floor_vertex
+{
+    point_t pos;
+    GLfloat shade;
+};
+
+constexpr color_t floor_color_dark = color_t::greyscale(.2f);
+constexpr color_t floor_color_bright = color_t::greyscale(.2f + 255 / 600.f);
+
+constexpr std::size_t instance_floats = graphics::instanced_double_program_t::instance_stride;
+
+void draw_single(const graphics::core& gl, const object& obj, const mat4x4_noopt_t& model_mat) noexcept
+{
+    auto mat = model_mat;
+    math::transform::translate(mat, obj.pos);
+    gl.prog.double_normal.set_transform(mat);
+    obj.draw(gl);
+}
+
+// Only adjacent crowd members sharing a type and key are batched, any other object in between ends the run
+void draw_objects(const graphics::core& gl, const std::vector<const object*>& order, const mat4x4_noopt_t& model_mat, const mat4x4_noopt_t& view_mat) noexcept
+{
+    std::vector<std::optional<crowd_member>> members(order.size());
+    bool any_crowd = false;
+    if (gl.instancing)
+    {
+        for (std::size_t i = 0; i < order.size(); ++i)
+            any_crowd |= static_cast<bool>(members[i] = order[i]->crowd());
+    }
+
+    graphics::stream_allocation instances{};
+    if (any_crowd)
+    {
+        instances = gl.stream.allocate(static_cast<GLsizeiptr>(order.size() * instance_floats * sizeof(GLfloat)));
+        auto out = instances.data;
+        for (std::size_t i = 0; i < order.size(); ++i, out += instance_floats)
+        {
+            if (members[i])
+            {
+                out[0] = order[i]->pos.x;
+                out[1] = order[i]->pos.y;
+                out[2] = members[i]->timer;
+                out[3] = members[i]->keyframes[0];
+                out[4] = members[i]->keyframes[1];
+                out[5] = members[i]->texture_shift;
+            }
+        }
+        gl.stream.flush();
+    }
+
+    const auto same_run = [&](const std::size_t lhs, const std::size_t rhs)
+    {
+        return members[rhs] && order[rhs]->variant.index() == order[lhs]->variant.index()
+            && members[rhs]->key == members[lhs]->key;
+    };
+
+    bool normal_in_use = false;
+    for (std::size_t begin = 0, end; begin < order.size(); begin = end)
+    {
+        end = begin + 1;
+        if (members[begin])
+        {
+            while (end < order.size() && same_run(begin, end))
+                ++end;
+        }
+
+        if (end - begin == 1)
+        {
+            if (!normal_in_use)
+            {
+                gl.prog.double_normal.use();
+                gl.prog.double_normal.set_color({1,1,1});
+                gl.prog.double_normal.set_view_transform(view_mat);
+                normal_in_use = true;
+            }
+            draw_single(gl, *order[begin], model_mat);
+            continue;
+        }
+
+        const auto& prog = gl.prog.double_instanced;
+        prog.use();
+        prog.set_color({1,1,1});
+        prog.set_transform(model_mat);
+        prog.set_view_transform(view_mat);
+        prog.begin_instances();
+        gl.stream.bind();
+        prog.instance_vertex(instances.offset + begin * instance_floats);
+        order[begin]->draw_crowd(gl, *members[begin], static_cast<GLsizei>(end - begin));
+        prog.end_instances();
+        graphics::vertex_buffer::unbind();
+        normal_in_use = false;
+    }
+}
+
+}  // namespace
+
 room::room() noexcept
     : player{ &objs.emplace(point_t{150.f,0}) }
 
@@ -62,7 +163,7 @@ room::room() noexcept
     //         }
     //     })
 {
-    pictures.load_image("octavia_tex.png", std::get<crimson::characters::octavia>(player.captive_mind->variant).tex, gl::NEAREST);
+    pictures.load_image(config::octavia_texture_asset, std::get<crimson::characters::octavia>(player.captive_mind->variant).tex, gl::NEAREST, garment::priority::visible);
     player.camera.translate = { 200, 200 };
 
     std::minstd_rand gen{};
@@ -71,19 +172,47 @@ room::room() noexcept
             [&](){ return static_cast<uint8_t>(rando(gen)); });
 }
 
+void room::build_floor_mesh() noexcept
+{
+    static constexpr std::array<point_t, 6> tile_triangles
+    {
+        point_t{0, 0},
+        point_t{tile_size, 0},
+        point_t{0, tile_size},
+        point_t{0, tile_size},
+        point_t{tile_size, 0},
+        point_t{tile_size, tile_size}
+    };
+
+    std::vector<floor_vertex> verts;
+    verts.reserve(floor_tiles.size() * tile_triangles.size());
+
+    for (unsigned y = 0; y < floor_size; ++y)
+        for (unsigned x = 0; x < floor_size; ++x)
+        {
+            const point_t origin{ x * tile_size, y * tile_size };
+            const GLfloat shade = floor_tiles[y * floor_size + x] / 255.f;
+
+            for (const auto& corner : tile_triangles)
+                verts.push_back({ origin + corner, shade });
+        }
+
+    floor_mesh.upload(verts.data(), static_cast<GLsizeiptr>(verts.size() * sizeof(floor_vertex)));
+}
+
 void room::draw(const graphics::core& gl) noexcept
 {
+    const auto& backdrop = gl.prog.dual_fill;
+    backdrop.use();
+    backdrop.set_identity();
+    backdrop.set_view_identity();
+    backdrop.set_mask_color(graphics::black, .125f);
+    backdrop.set_color(graphics::black);
+    gl.draw_views(backdrop, [&gl, &backdrop] { fill_screen(gl, backdrop); });
+
     gl.prog.fill.use();
     gl.prog.fill.set_identity();
     gl.prog.fill.set_view_identity();
-    gl.view_mask();
-    gl.prog.fill.set_color(graphics::black, .125f);
-    fill_screen(gl, gl.prog.fill);
-
-    gl.view_normal();
-    gl.prog.fill.set_color(graphics::black);
-    fill_screen(gl, gl.prog.fill);
-
     gl.prog.fill.set_color({1,1,1});
 
     constexpr mat4x4_noopt_t skew_matrix =
@@ -110,33 +239,53 @@ void room::draw(const graphics::core& gl) noexcept
             return mat;
         }();
 
+    if (floor_changed.exchange(false, std::memory_order_acquire) || !floor_mesh.is_current())
+    {
+        build_floor_mesh();
+    }
+    else
+    {
+        floor_mesh.bind();
+    }
+
+    constexpr auto floor_stride = static_cast<GLsizei>(sizeof(floor_vertex));
+
+    gl.prog.gradient.use();
+    gl.prog.gradient.set_color(floor_color_dark);
+    gl.prog.gradient.set_secondary_color(floor_color_bright);
+    gl.prog.gradient.set_view_transform(view_mat);
+    gl.prog.gradient.set_transform(math::matrices::translate(player.camera.translate * -1.f));
+    gl.prog.gradient.position_vertex(nullptr, floor_stride);
+    gl.prog.gradient.interpolation_vertex(reinterpret_cast<const GLfloat*>(offsetof(floor_vertex, shade)), floor_stride);
+    gl::DrawArrays(gl::TRIANGLES, 0, static_cast<GLsizei>(floor_tiles.size() * 6));
+    graphics::vertex_buffer::unbind();
+
     static constexpr std::array<point_t, 4> tile_rectangle
     {
         point_t{0, 0},
-        point_t{32, 0},
-        point_t{0, 32},
-        point_t{32, 32}
+        point_t{tile_size, 0},
+        point_t{0, tile_size},
+        point_t{tile_size, tile_size}
     };
 
-    gl.prog.fill.position_vertex(reinterpret_cast<const GLfloat*>(&tile_rectangle[0]));
+    gl.prog.fill.use();
     gl.prog.fill.set_view_transform(view_mat);
 
-    for (int y = 0; y < 32; ++y)
-        for (int x = 0; x < 32; ++x)
-        {
-            if (x == int(player.captive_mind->pos.x / 32) && y == int(player.captive_mind->pos.y / 32))
-            {
-                gl.prog.fill.set_color(color_t::greyscale(1.f));
-            }
-            else
-            {
-                gl.prog.fill.set_color(color_t::greyscale(.2f + floor_tiles[y * 32 + x] / 600.f));
-            }
+    if (player.captive_mind)
+    {
+        const int x = player.captive_mind->pos.x / tile_size;
+        const int y = player.captive_mind->pos.y / tile_size;
 
-            gl.prog.fill.set_transform(math::matrices::translate(point_t{ x * 32.f, y * 32.f } - player.camera.translate));
+        if (x >= 0 && y >= 0 && x < int(floor_size) && y < int(floor_size))
+        {
+            gl.prog.fill.set_color(color_t::greyscale(1.f));
+            gl.prog.fill.set_transform(math::matrices::translate(point_t{ x * tile_size, y * tile_size } - player.camera.translate));
+            gl.prog.fill.position_vertex(reinterpret_cast<const GLfloat*>(&tile_rectangle[0]));
             gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
         }
+    }
 
+    gl.prog.fill.set_color({1,1,1});
     gl.prog.fill.set_transform(model_mat);
     gl.prog.fill.set_view_transform(view_mat);
 
@@ -157,27 +306,20 @@ void room::draw(const graphics::core& gl) noexcept
     gl.prog.fill.position_vertex(reinterpret_cast<const GLfloat*>(&helper_lines[0][0]));
     gl::DrawArrays(gl::LINES, 0, helper_lines.size() * 2);
 
-    gl.prog.double_normal.use();
-    gl.prog.double_normal.set_color({1,1,1});
-    gl.prog.double_normal.set_transform(skew_matrix);
-    gl.prog.double_normal.set_view_transform(view_mat);
-
     const std::lock_guard block_object_destruction{ cell_mod_mutex };
-    for (const auto it : render_order[draw_fork.load(std::memory_order_acquire)])
-    {
-        auto mat = model_mat;
-        math::transform::translate(mat, it->pos);
-        gl.prog.double_normal.set_transform(mat);
-        it->draw(gl);
-    }
+    const auto& order = render_order[draw_fork.load(std::memory_order_acquire)];
+
+    draw_objects(gl, order, model_mat, view_mat);
 
-    gl.prog.text.use();
-    gl.prog.text.set_color({1,1,1});
+    gl.prog.sdf_text.use();
+    gl.prog.sdf_text.set_color({1,1,1});
+    gl.prog.sdf_text.set_outline({0, 0, 0, .8f}, .1f);
     char str[120];
     std::snprintf(str, 120, "camera: [%.1f, %.1f]\ncursor: [%.1f, %.1f]",
             player.camera.translate.x, player.camera.translate.y,
             player.cursor_pos.x, player.cursor_pos.y);
-    draw_text<text_align::near, text_align::near>(*gl.fonts.regular, gl.prog.text, str, point_t{10, 50}, 16);
+    draw_text<text_align::near, text_align::near>(*gl.fonts.regular, gl.prog.sdf_text, str, point_t{10, 50}, 16);
+    gl.prog.sdf_text.set_outline({0, 0, 0, 0}, 0);
 }
 
 void room::on_resize(const point_t size) noexcept
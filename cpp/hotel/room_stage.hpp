@@ -25,6 +25,7 @@
 #include "keys.hpp"
 #include <colony.hpp>
 #include "image_loader.hpp"
+#include "../assets_config.hpp"
 #include <mutex>
 #include "stage_objects.hpp"
 #include "stage_crawlers.hpp"
@@ -43,9 +44,19 @@ private:
     std::array<std::vector<const object*>, 6> render_order;
     cells::colony<unsigned, object> objs;
     player_object player;
-    std::array<uint8_t, 32 * 32> floor_tiles;
+
+    static constexpr unsigned floor_size = 32;
+    static constexpr float tile_size = 32.f;
+
+    std::array<uint8_t, floor_size * floor_size> floor_tiles;
+    graphics::vertex_buffer floor_mesh;
+    std::atomic_bool floor_changed = true;
+
+    void build_floor_mesh() noexcept;
 
 public:
+    static constexpr const char * manifest[] { config::octavia_texture_asset };
+
     room() noexcept;
 
     void on_resize(point_t) noexcept;
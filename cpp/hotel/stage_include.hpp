@@ -18,6 +18,8 @@
 */
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <idle/gl.hpp>
 
 namespace idle::hotel::stage
@@ -31,5 +33,15 @@ enum class action
     destroy
 };
 
+// Objects of one type sharing a key are drawn by a single instanced call,
+// each with its own keyframes and texture shift
+struct crowd_member
+{
+    std::uint64_t key;
+    GLfloat timer;
+    std::array<GLfloat, 2> keyframes;
+    GLfloat texture_shift;
+};
+
 }  // namespace idle::hotel::stage
 
@@ -29,6 +29,7 @@ namespace
 idle_check_method_boilerplate(check_drawable);
 idle_check_method_boilerplate(step);
 idle_check_method_boilerplate(draw);
+idle_check_method_boilerplate(crowd);
 idle_check_method_boilerplate(push_move);
 idle_check_method_boilerplate(apply_physics);
 
@@ -105,5 +106,33 @@ void object::draw(const graphics::core& gl) const noexcept
     variant);
 }
 
+std::optional<crowd_member> object::crowd() const noexcept
+{
+    return std::visit([](const auto& obj) -> std::optional<crowd_member>
+    {
+        if constexpr(idle_has_method(idle_remove_cvr(obj), crowd))
+        {
+            return obj.crowd();
+        }
+        else
+        {
+            return {};
+        }
+    },
+    variant);
+}
+
+void object::draw_crowd(const graphics::core& gl, const crowd_member& member, const GLsizei count) const noexcept
+{
+    std::visit([&gl, &member, count](const auto& obj)
+    {
+        if constexpr(idle_has_method(idle_remove_cvr(obj), crowd))
+        {
+            return obj.draw_crowd(gl, member, count);
+        }
+    },
+    variant);
+}
+
 }  // namespace idle::hotel::stage
 
@@ -18,6 +18,7 @@
 */
 #pragma once
 
+#include <optional>
 #include "stage_include.hpp"
 #include "../game/objects.hpp"
 
@@ -36,6 +37,10 @@ struct object
 
     void draw(const graphics::core& gl) const noexcept;
 
+    std::optional<crowd_member> crowd() const noexcept;
+
+    void draw_crowd(const graphics::core& gl, const crowd_member& member, GLsizei count) const noexcept;
+
     void move(float direction, float value) noexcept;
 };
 
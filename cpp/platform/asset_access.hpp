@@ -17,8 +17,11 @@
     along with Idle. If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
+#include <future>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <log.hpp>
 
 namespace platform
@@ -33,6 +36,7 @@ class asset
 
     friend void ::android_main(android_app *);
     friend struct context;
+    friend std::string cache_path(std::string_view) noexcept;
 
     AAsset * file = nullptr;
     std::string_view data;
@@ -47,17 +51,18 @@ public:
 
 #else
 private:
-    std::unique_ptr<unsigned char[]> ptr;
-    size_t size = 0;
+    std::string_view data;
+    void * mapping = nullptr;  // only set for loose files, pack views borrow the pack mapping
 
     asset() noexcept = default;
 
-    template<typename Ptr>
-    asset(Ptr&& p, size_t s) noexcept
-        : ptr(std::forward<Ptr>(p)), size(s) {}
+    asset(std::string_view d, void * m) noexcept
+        : data(d), mapping(m) {}
 
 public:
-    asset(asset&&) noexcept = default;
+    asset(asset&&) noexcept;
+
+    ~asset() noexcept;
 
 #endif
 
@@ -70,7 +75,31 @@ public:
     static asset hold(const char * path) noexcept;
 
     static asset hold(std::string path) noexcept;
+
+    // Same as hold, but a missing file is not worth an error
+    static asset hold_if_present(const char * path) noexcept;
+
+    // Reads the file on the I/O threads
+    static std::future<asset> hold_async(std::string path) noexcept;
+
+    // Reads ahead on the I/O threads, the next hold of the same name takes the result over;
+    // when path turns out to be missing the fallback is read in its place
+    static void prefetch(std::string path, std::string fallback = {}) noexcept;
+
+    // Forgets whatever was prefetched and never held
+    static void drop_prefetched() noexcept;
+
+    static void log_prefetch_counters() noexcept;
+
+private:
+    static asset open(const char * path, bool report_missing) noexcept;
+
+    static std::optional<asset> take_prefetched(const char * path) noexcept;
 };
 
+// Where files that can always be regenerated are kept between runs,
+// empty when there is no writable location
+std::string cache_path(std::string_view file_name) noexcept;
+
 }  // namespace platform
 
@@ -0,0 +1,236 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_access.hpp"
+
+namespace platform
+{
+namespace
+{
+
+constexpr unsigned io_thread_count = 2;
+constexpr size_t page_size = 4096;
+
+std::atomic<unsigned> prefetch_hits = 0, prefetch_misses = 0;
+std::atomic<size_t> bytes_read_ahead = 0;
+
+// Faults every page in, so that whoever holds the asset next finds it resident
+void read_ahead(const std::string_view data) noexcept
+{
+    unsigned char sum = 0;
+    for (size_t i = 0; i < data.size(); i += page_size)
+        sum += static_cast<unsigned char>(data[i]);
+
+    [[maybe_unused]] volatile unsigned char sink = sum;
+    bytes_read_ahead.fetch_add(data.size(), std::memory_order_relaxed);
+}
+
+class io_pool
+{
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::packaged_task<void()>> jobs;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+
+    void work() noexcept
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (jobs.empty())
+                return;
+
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job();
+        }
+    }
+
+public:
+    void submit(std::packaged_task<void()> job) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+
+            if (threads.empty())
+                for (unsigned i = 0; i < io_thread_count; ++i)
+                    threads.emplace_back([this] { work(); });
+        }
+        wake.notify_one();
+    }
+
+    ~io_pool() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto& t : threads)
+            t.join();
+    }
+};
+
+io_pool& io() noexcept
+{
+    static io_pool instance;
+    return instance;
+}
+
+std::mutex prefetch_mutex;
+std::unordered_map<std::string, std::future<asset>> prefetched;
+
+}  // namespace
+
+std::future<asset> asset::hold_async(std::string path) noexcept
+{
+    std::promise<asset> promise;
+    auto out = promise.get_future();
+
+    io().submit(std::packaged_task<void()>{ [path = std::move(path), promise = std::move(promise)]() mutable
+        {
+            auto file = open(path.c_str(), true);
+            read_ahead(file.view());
+            promise.set_value(std::move(file));
+        }});
+
+    return out;
+}
+
+void asset::prefetch(std::string path, std::string fallback) noexcept
+{
+    std::promise<asset> primary, secondary;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        if (prefetched.contains(path))
+            return;
+
+        prefetched.emplace(path, primary.get_future());
+        if (!fallback.empty() && !prefetched.contains(fallback))
+            prefetched.emplace(fallback, secondary.get_future());
+        else
+            fallback.clear();
+    }
+
+    io().submit(std::packaged_task<void()>{
+            [path = std::move(path), fallback = std::move(fallback),
+            primary = std::move(primary), secondary = std::move(secondary)]() mutable
+        {
+            auto file = open(path.c_str(), false);
+            read_ahead(file.view());
+            const bool found = !!file;
+            primary.set_value(std::move(file));
+
+            if (fallback.empty())
+                return;
+
+            if (found)
+            {
+                secondary.set_value(asset{});
+                return;
+            }
+
+            auto other = open(fallback.c_str(), false);
+            read_ahead(other.view());
+            secondary.set_value(std::move(other));
+        }});
+}
+
+std::optional<asset> asset::take_prefetched(const char * const path) noexcept
+{
+    std::future<asset> pending;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        const auto it = prefetched.find(path);
+        if (it == prefetched.end())
+        {
+            prefetch_misses.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+        pending = std::move(it->second);
+        prefetched.erase(it);
+    }
+
+    if (auto file = pending.get())
+    {
+        prefetch_hits.fetch_add(1, std::memory_order_relaxed);
+        return { std::move(file) };
+    }
+
+    prefetch_misses.fetch_add(1, std::memory_order_relaxed);
+    return {};
+}
+
+void asset::drop_prefetched() noexcept
+{
+    std::unordered_map<std::string, std::future<asset>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        dropped.swap(prefetched);
+    }
+
+    if (dropped.size())
+        LOGD("Dropping %zu prefetched assets nobody asked for", dropped.size());
+}
+
+void asset::log_prefetch_counters() noexcept
+{
+    LOGI("Assets: %u prefetch hits, %u misses, %zu KB read ahead",
+            prefetch_hits.load(std::memory_order_relaxed),
+            prefetch_misses.load(std::memory_order_relaxed),
+            bytes_read_ahead.load(std::memory_order_relaxed) / 1024);
+}
+
+asset asset::hold(std::string path) noexcept
+{
+    return hold(path.c_str());
+}
+
+asset asset::hold(const char * path) noexcept
+{
+    if (auto file = take_prefetched(path))
+        return std::move(*file);
+
+    return open(path, true);
+}
+
+asset asset::hold_if_present(const char * path) noexcept
+{
+    if (auto file = take_prefetched(path))
+        return std::move(*file);
+
+    return open(path, false);
+}
+
+}  // namespace platform
@@ -0,0 +1,130 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+namespace platform::pack
+{
+
+// A single file holding every asset: the header, the entries sorted by name,
+// the names themselves, then the file contents, each starting on a 16 byte boundary
+struct header
+{
+    static constexpr char signature[4] { 'I', 'D', 'P', 'K' };
+    static constexpr std::uint32_t current_version = 1;
+
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint32_t names_size;
+};
+
+struct entry
+{
+    std::uint32_t name_offset, name_size;
+    std::uint64_t offset, size;
+    std::uint32_t checksum;  // crc32 of the contents
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(header) == 16 && sizeof(entry) == 32);
+
+constexpr std::uint64_t data_alignment = 16;
+
+class index
+{
+    std::string_view pack;
+    const entry * entries = nullptr;
+    const char * names = nullptr;
+    std::uint32_t count = 0;
+
+    std::string_view name_of(const entry& e) const noexcept
+    {
+        return { names + e.name_offset, e.name_size };
+    }
+
+public:
+    constexpr index() noexcept = default;
+
+    // Checks every bound once so that lookups can trust the entries
+    static std::optional<index> open(const std::string_view pack) noexcept
+    {
+        header h;
+        if (pack.size() < sizeof(h))
+            return {};
+        std::memcpy(&h, pack.data(), sizeof(h));
+
+        if (std::memcmp(h.magic, header::signature, sizeof(h.magic)) != 0 || h.version != header::current_version)
+            return {};
+
+        const std::uint64_t names_start = sizeof(h) + std::uint64_t{ h.count } * sizeof(entry);
+        if (names_start + h.names_size > pack.size())
+            return {};
+
+        index out;
+        out.pack = pack;
+        out.entries = reinterpret_cast<const entry*>(pack.data() + sizeof(h));
+        out.names = pack.data() + names_start;
+        out.count = h.count;
+
+        for (std::uint32_t i = 0; i < h.count; ++i)
+        {
+            const auto& e = out.entries[i];
+            if (std::uint64_t{ e.name_offset } + e.name_size > h.names_size
+                    || e.offset > pack.size() || e.size > pack.size() - e.offset
+                    || (i && !(out.name_of(out.entries[i - 1]) < out.name_of(e))))
+                return {};
+        }
+        return out;
+    }
+
+    const entry * find(const std::string_view name) const noexcept
+    {
+        std::uint32_t low = 0, high = count;
+        while (low < high)
+        {
+            const auto mid = low + (high - low) / 2;
+            const auto cmp = name_of(entries[mid]).compare(name);
+            if (!cmp)
+                return entries + mid;
+            if (cmp < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return nullptr;
+    }
+
+    std::string_view contents(const entry& e) const noexcept
+    {
+        return pack.substr(e.offset, e.size);
+    }
+
+    std::uint32_t size() const noexcept
+    {
+        return count;
+    }
+};
+
+}  // namespace platform::pack
@@ -339,18 +339,18 @@ std::string_view asset::view() const noexcept
     return data;
 }
 
-asset asset::hold(std::string path) noexcept
-{
-    return hold(path.c_str());
-}
-
-asset asset::hold(const char * path) noexcept
+asset asset::open(const char * path, const bool report_missing) noexcept
 {
     std::unique_ptr<AAsset, decltype(&AAsset_close)> file{
             AAssetManager_open(android_activity->activity->assetManager, path, AASSET_MODE_BUFFER),
             AAsset_close
         };
 
+    if (!file && !report_missing)
+    {
+        return {};
+    }
+
     if (auto data = file ? AAsset_getBuffer(file.get()) : nullptr; !data)
     {
         LOGE("Error loading asset `%s`", path);
@@ -363,4 +363,15 @@ asset asset::hold(const char * path) noexcept
     }
 }
 
+std::string cache_path(const std::string_view file_name) noexcept
+{
+    if (!asset::android_activity || !asset::android_activity->activity->internalDataPath)
+        return {};
+
+    std::string path{ asset::android_activity->activity->internalDataPath };
+    path += '/';
+    path += file_name;
+    return path;
+}
+
 }  // namespace platform
@@ -393,6 +393,32 @@ namespace gl
     PFNVIEWPORT Viewport = 0;
     typedef const GLubyte * (CODEGEN_FUNCPTR *PFNGETSTRINGI)(GLenum, GLuint);
     PFNGETSTRINGI GetStringi = 0;
+#if !defined(GL_USE_ALL_AVAILABLE_EXT) || defined(__ANDROID__)
+    typedef void (CODEGEN_FUNCPTR *PFNDRAWARRAYSINSTANCED)(GLenum, GLint, GLsizei, GLsizei);
+    PFNDRAWARRAYSINSTANCED DrawArraysInstanced = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNGENQUERIES)(GLsizei, GLuint *);
+    PFNGENQUERIES GenQueries = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNDELETEQUERIES)(GLsizei, const GLuint *);
+    PFNDELETEQUERIES DeleteQueries = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNBEGINQUERY)(GLenum, GLuint);
+    PFNBEGINQUERY BeginQuery = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNENDQUERY)(GLenum);
+    PFNENDQUERY EndQuery = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNGETQUERYOBJECTUIV)(GLuint, GLenum, GLuint *);
+    PFNGETQUERYOBJECTUIV GetQueryObjectuiv = 0;
+#endif
+    typedef void (CODEGEN_FUNCPTR *PFNVERTEXATTRIBDIVISOR)(GLuint, GLuint);
+    PFNVERTEXATTRIBDIVISOR VertexAttribDivisor = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNGETQUERYOBJECTUI64V)(GLuint, GLenum, GLuint64 *);
+    PFNGETQUERYOBJECTUI64V GetQueryObjectui64v = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNGETPROGRAMBINARY)(GLuint, GLsizei, GLsizei *, GLenum *, void *);
+    PFNGETPROGRAMBINARY GetProgramBinary = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNPROGRAMBINARY)(GLuint, GLenum, const void *, GLsizei);
+    PFNPROGRAMBINARY ProgramBinary = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNPROGRAMPARAMETERI)(GLuint, GLenum, GLint);
+    PFNPROGRAMPARAMETERI ProgramParameteri = 0;
+    typedef void (CODEGEN_FUNCPTR *PFNMAXSHADERCOMPILERTHREADS)(GLuint);
+    PFNMAXSHADERCOMPILERTHREADS MaxShaderCompilerThreads = 0;
 #ifdef GL_USE_ALL_AVAILABLE_EXT
 #ifndef __ANDROID__
     typedef void (CODEGEN_FUNCPTR *PFNBEGINCONDITIONALRENDER)(GLuint, GLenum);
@@ -765,6 +791,54 @@ namespace gl
 #endif
 #endif
 
+    static void LoadOptionalFunctions()
+    {
+        if(!DrawArraysInstanced)
+            DrawArraysInstanced = reinterpret_cast<PFNDRAWARRAYSINSTANCED>(IntGetProcAddress("glDrawArraysInstanced"));
+        VertexAttribDivisor = reinterpret_cast<PFNVERTEXATTRIBDIVISOR>(IntGetProcAddress("glVertexAttribDivisor"));
+
+#ifdef __ANDROID__
+        // GL_EXT_disjoint_timer_query
+        GenQueries = reinterpret_cast<PFNGENQUERIES>(IntGetProcAddress("glGenQueriesEXT"));
+        DeleteQueries = reinterpret_cast<PFNDELETEQUERIES>(IntGetProcAddress("glDeleteQueriesEXT"));
+        BeginQuery = reinterpret_cast<PFNBEGINQUERY>(IntGetProcAddress("glBeginQueryEXT"));
+        EndQuery = reinterpret_cast<PFNENDQUERY>(IntGetProcAddress("glEndQueryEXT"));
+        GetQueryObjectuiv = reinterpret_cast<PFNGETQUERYOBJECTUIV>(IntGetProcAddress("glGetQueryObjectuivEXT"));
+        GetQueryObjectui64v = reinterpret_cast<PFNGETQUERYOBJECTUI64V>(IntGetProcAddress("glGetQueryObjectui64vEXT"));
+#else
+        // GL_ARB_timer_query
+        if(!GenQueries)
+            GenQueries = reinterpret_cast<PFNGENQUERIES>(IntGetProcAddress("glGenQueries"));
+        if(!DeleteQueries)
+            DeleteQueries = reinterpret_cast<PFNDELETEQUERIES>(IntGetProcAddress("glDeleteQueries"));
+        if(!BeginQuery)
+            BeginQuery = reinterpret_cast<PFNBEGINQUERY>(IntGetProcAddress("glBeginQuery"));
+        if(!EndQuery)
+            EndQuery = reinterpret_cast<PFNENDQUERY>(IntGetProcAddress("glEndQuery"));
+        if(!GetQueryObjectuiv)
+            GetQueryObjectuiv = reinterpret_cast<PFNGETQUERYOBJECTUIV>(IntGetProcAddress("glGetQueryObjectuiv"));
+        GetQueryObjectui64v = reinterpret_cast<PFNGETQUERYOBJECTUI64V>(IntGetProcAddress("glGetQueryObjectui64v"));
+#endif
+
+        // GL_ARB_get_program_binary, core in ES 3.0
+        GetProgramBinary = reinterpret_cast<PFNGETPROGRAMBINARY>(IntGetProcAddress("glGetProgramBinary"));
+        ProgramBinary = reinterpret_cast<PFNPROGRAMBINARY>(IntGetProcAddress("glProgramBinary"));
+        ProgramParameteri = reinterpret_cast<PFNPROGRAMPARAMETERI>(IntGetProcAddress("glProgramParameteri"));
+#ifdef __ANDROID__
+        // GL_OES_get_program_binary
+        if(!GetProgramBinary || !ProgramBinary)
+        {
+            GetProgramBinary = reinterpret_cast<PFNGETPROGRAMBINARY>(IntGetProcAddress("glGetProgramBinaryOES"));
+            ProgramBinary = reinterpret_cast<PFNPROGRAMBINARY>(IntGetProcAddress("glProgramBinaryOES"));
+        }
+#endif
+
+        // GL_KHR_parallel_shader_compile, resolved even when the extension is missing
+        MaxShaderCompilerThreads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADS>(IntGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        if(!MaxShaderCompilerThreads)
+            MaxShaderCompilerThreads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADS>(IntGetProcAddress("glMaxShaderCompilerThreadsARB"));
+    }
+
     static int LoadCoreFunctions()
     {
         int numFailed = 0;
@@ -1502,6 +1576,10 @@ namespace gl
             ProcExtsFromExtList(table);
 #endif
             int numFailed = LoadCoreFunctions();
+            LoadOptionalFunctions();
+#ifdef IDLE_COMPILE_GL_TRACE
+            trace::Install();
+#endif
             return exts::LoadTest(true, numFailed);
         }
 
@@ -1556,6 +1634,31 @@ namespace gl
             return false;
         }
 
+        bool IsExtensionSupported(const char *extensionName)
+        {
+#ifndef __ANDROID__
+            GLint numExtensions = 0;
+            GetIntegerv(NUM_EXTENSIONS, &numExtensions);
+
+            for(GLint i = 0; i < numExtensions; ++i)
+            {
+                const char *name = (const char *)GetStringi(EXTENSIONS, i);
+                if(name && strcmp(name, extensionName) == 0) return true;
+            }
+#else
+            const size_t length = strlen(extensionName);
+
+            for(const char *list = (const char *)GetString(EXTENSIONS); list && *list;)
+            {
+                const char *end = strchr(list, ' ');
+                const size_t size = end ? static_cast<size_t>(end - list) : strlen(list);
+                if(size == length && strncmp(list, extensionName, length) == 0) return true;
+                list = end ? end + 1 : 0;
+            }
+#endif
+            return false;
+        }
+
     } //namespace sys
 } //namespace gl
 #undef IntGetProcAddress
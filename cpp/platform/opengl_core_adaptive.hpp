@@ -1031,6 +1031,8 @@ namespace gl
         MEDIUM_INT                         = 0x8df4,
         NUM_SHADER_BINARY_FORMATS          = 0x8df9,
         RED_BITS                           = 0xd52,
+        RG                                 = 0x8227,
+        RG32F                              = 0x8230,
         RGB565                             = 0x8d62,
         SHADER_BINARY_FORMATS              = 0x8df8,
         SHADER_COMPILER                    = 0x8dfa,
@@ -1365,6 +1367,36 @@ namespace gl
 #endif
 #endif
 
+    // Optional entry points, left null when the context does not export them
+    enum
+    {
+        TIME_ELAPSED                       = 0x88bf,
+        GPU_DISJOINT                       = 0x8fbb,
+        PROGRAM_BINARY_RETRIEVABLE_HINT    = 0x8257,
+        PROGRAM_BINARY_LENGTH              = 0x8741,
+        NUM_PROGRAM_BINARY_FORMATS         = 0x87fe,
+        COMPLETION_STATUS                  = 0x91b1,
+#ifdef __ANDROID__
+        QUERY_RESULT                       = 0x8866,
+        QUERY_RESULT_AVAILABLE             = 0x8867,
+#endif
+    };
+
+#if !defined(GL_USE_ALL_AVAILABLE_EXT) || defined(__ANDROID__)
+    extern void (CODEGEN_FUNCPTR *DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+    extern void (CODEGEN_FUNCPTR *GenQueries)(GLsizei n, GLuint * ids);
+    extern void (CODEGEN_FUNCPTR *DeleteQueries)(GLsizei n, const GLuint * ids);
+    extern void (CODEGEN_FUNCPTR *BeginQuery)(GLenum target, GLuint id);
+    extern void (CODEGEN_FUNCPTR *EndQuery)(GLenum target);
+    extern void (CODEGEN_FUNCPTR *GetQueryObjectuiv)(GLuint id, GLenum pname, GLuint * params);
+#endif
+    extern void (CODEGEN_FUNCPTR *VertexAttribDivisor)(GLuint index, GLuint divisor);
+    extern void (CODEGEN_FUNCPTR *GetQueryObjectui64v)(GLuint id, GLenum pname, GLuint64 * params);
+    extern void (CODEGEN_FUNCPTR *GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei * length, GLenum * binaryFormat, void * binary);
+    extern void (CODEGEN_FUNCPTR *ProgramBinary)(GLuint program, GLenum binaryFormat, const void * binary, GLsizei length);
+    extern void (CODEGEN_FUNCPTR *ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+    extern void (CODEGEN_FUNCPTR *MaxShaderCompilerThreads)(GLuint count);
+
     namespace sys
     {
 
@@ -1373,7 +1405,35 @@ namespace gl
         int GetMinorVersion();
         int GetMajorVersion();
         bool IsVersionGEQ(int majorVersion, int minorVersion);
+        bool IsExtensionSupported(const char *extensionName);
 
     } //namespace sys
+
+#ifdef IDLE_COMPILE_GL_TRACE
+    namespace trace
+    {
+        struct FrameStats
+        {
+            unsigned calls = 0;
+            unsigned drawCalls = 0;
+            unsigned long long vertices = 0;
+            unsigned stateChanges = 0;
+            unsigned uniformUploads = 0;
+            unsigned textureBinds = 0;
+        };
+
+        //Wraps the loaded entry points, called by LoadFunctions.
+        void Install();
+
+        //Closes the statistics of the current frame and finishes a running capture.
+        void NextFrame();
+
+        const FrameStats& LastFrame();
+
+        //Writes every call of the next frame to a file. Safe to call from a signal handler.
+        void RequestCapture();
+
+    } //namespace trace
+#endif
 } //namespace gl
 #endif //POINTER_CPP_GENERATED_HEADEROPENGL_HPP
@@ -0,0 +1,368 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+#ifndef __ANDROID__
+#include <csignal>
+#endif
+#include <log.hpp>
+#include "opengl_core_adaptive.hpp"
+
+namespace gl::trace
+{
+
+namespace
+{
+
+enum class category : uint8_t
+{
+    other,
+    draw,
+    state,
+    uniform,
+    texture
+};
+
+#define IDLE_GL_TRACED(X) \
+    X(ActiveTexture, texture) \
+    X(AttachShader, other) \
+    X(BindAttribLocation, other) \
+    X(BindBuffer, state) \
+    X(BindFramebuffer, state) \
+    X(BindRenderbuffer, state) \
+    X(BindTexture, texture) \
+    X(BlendColor, state) \
+    X(BlendEquation, state) \
+    X(BlendEquationSeparate, state) \
+    X(BlendFunc, state) \
+    X(BlendFuncSeparate, state) \
+    X(BufferData, other) \
+    X(BufferSubData, other) \
+    X(CheckFramebufferStatus, other) \
+    X(Clear, other) \
+    X(ClearColor, state) \
+    X(ClearStencil, state) \
+    X(ColorMask, state) \
+    X(CompileShader, other) \
+    X(CompressedTexImage2D, other) \
+    X(CompressedTexSubImage2D, other) \
+    X(CopyTexImage2D, other) \
+    X(CopyTexSubImage2D, other) \
+    X(CreateProgram, other) \
+    X(CreateShader, other) \
+    X(CullFace, state) \
+    X(DeleteBuffers, other) \
+    X(DeleteFramebuffers, other) \
+    X(DeleteProgram, other) \
+    X(DeleteRenderbuffers, other) \
+    X(DeleteShader, other) \
+    X(DeleteTextures, other) \
+    X(DepthFunc, state) \
+    X(DepthMask, state) \
+    X(DetachShader, other) \
+    X(Disable, state) \
+    X(DisableVertexAttribArray, state) \
+    X(DrawArrays, draw) \
+    X(DrawElements, draw) \
+    X(Enable, state) \
+    X(EnableVertexAttribArray, state) \
+    X(Finish, other) \
+    X(Flush, other) \
+    X(FramebufferRenderbuffer, other) \
+    X(FramebufferTexture2D, other) \
+    X(FrontFace, state) \
+    X(GenBuffers, other) \
+    X(GenFramebuffers, other) \
+    X(GenRenderbuffers, other) \
+    X(GenTextures, other) \
+    X(GenerateMipmap, other) \
+    X(GetActiveAttrib, other) \
+    X(GetActiveUniform, other) \
+    X(GetAttachedShaders, other) \
+    X(GetAttribLocation, other) \
+    X(GetBooleanv, other) \
+    X(GetBufferParameteriv, other) \
+    X(GetError, other) \
+    X(GetFloatv, other) \
+    X(GetFramebufferAttachmentParameteriv, other) \
+    X(GetIntegerv, other) \
+    X(GetProgramInfoLog, other) \
+    X(GetProgramiv, other) \
+    X(GetRenderbufferParameteriv, other) \
+    X(GetShaderInfoLog, other) \
+    X(GetShaderSource, other) \
+    X(GetShaderiv, other) \
+    X(GetString, other) \
+    X(GetTexParameterfv, other) \
+    X(GetTexParameteriv, other) \
+    X(GetUniformLocation, other) \
+    X(GetUniformfv, other) \
+    X(GetUniformiv, other) \
+    X(GetVertexAttribPointerv, other) \
+    X(GetVertexAttribfv, other) \
+    X(GetVertexAttribiv, other) \
+    X(Hint, state) \
+    X(IsBuffer, other) \
+    X(IsEnabled, other) \
+    X(IsFramebuffer, other) \
+    X(IsProgram, other) \
+    X(IsRenderbuffer, other) \
+    X(IsShader, other) \
+    X(IsTexture, other) \
+    X(LineWidth, state) \
+    X(LinkProgram, other) \
+    X(PixelStorei, state) \
+    X(PolygonOffset, state) \
+    X(ReadPixels, other) \
+    X(RenderbufferStorage, other) \
+    X(SampleCoverage, state) \
+    X(Scissor, state) \
+    X(ShaderSource, other) \
+    X(StencilFunc, state) \
+    X(StencilFuncSeparate, state) \
+    X(StencilMask, state) \
+    X(StencilMaskSeparate, state) \
+    X(StencilOp, state) \
+    X(StencilOpSeparate, state) \
+    X(TexImage2D, other) \
+    X(TexParameterf, state) \
+    X(TexParameterfv, state) \
+    X(TexParameteri, state) \
+    X(TexParameteriv, state) \
+    X(TexSubImage2D, other) \
+    X(Uniform1f, uniform) \
+    X(Uniform1fv, uniform) \
+    X(Uniform1i, uniform) \
+    X(Uniform1iv, uniform) \
+    X(Uniform2f, uniform) \
+    X(Uniform2fv, uniform) \
+    X(Uniform2i, uniform) \
+    X(Uniform2iv, uniform) \
+    X(Uniform3f, uniform) \
+    X(Uniform3fv, uniform) \
+    X(Uniform3i, uniform) \
+    X(Uniform3iv, uniform) \
+    X(Uniform4f, uniform) \
+    X(Uniform4fv, uniform) \
+    X(Uniform4i, uniform) \
+    X(Uniform4iv, uniform) \
+    X(UniformMatrix2fv, uniform) \
+    X(UniformMatrix3fv, uniform) \
+    X(UniformMatrix4fv, uniform) \
+    X(UseProgram, state) \
+    X(ValidateProgram, other) \
+    X(VertexAttrib1f, state) \
+    X(VertexAttrib1fv, state) \
+    X(VertexAttrib2f, state) \
+    X(VertexAttrib2fv, state) \
+    X(VertexAttrib3f, state) \
+    X(VertexAttrib3fv, state) \
+    X(VertexAttrib4f, state) \
+    X(VertexAttrib4fv, state) \
+    X(VertexAttribPointer, state) \
+    X(Viewport, state) \
+    X(DrawArraysInstanced, draw) \
+    X(VertexAttribDivisor, state) \
+    X(GenQueries, other) \
+    X(DeleteQueries, other) \
+    X(BeginQuery, other) \
+    X(EndQuery, other) \
+    X(GetQueryObjectuiv, other) \
+    X(GetQueryObjectui64v, other) \
+    X(GetProgramBinary, other) \
+    X(ProgramBinary, other) \
+    X(ProgramParameteri, other) \
+    X(MaxShaderCompilerThreads, other)
+
+enum class traced : unsigned
+{
+#define X(name, kind) name,
+    IDLE_GL_TRACED(X)
+#undef X
+};
+
+constexpr const char* traced_names[]
+{
+#define X(name, kind) #name,
+    IDLE_GL_TRACED(X)
+#undef X
+};
+
+constexpr category traced_categories[]
+{
+#define X(name, kind) category::kind,
+    IDLE_GL_TRACED(X)
+#undef X
+};
+
+FrameStats current, last;
+unsigned frame_index = 0, capture_frame = 0;
+std::FILE* capture = nullptr;
+std::atomic_bool capture_requested = false;
+
+static_assert(decltype(capture_requested)::is_always_lock_free);
+
+template<typename T>
+void write_argument(const T value)
+{
+    if constexpr (std::is_pointer_v<T>)
+        std::fprintf(capture, "%p", static_cast<const void*>(value));
+    else if constexpr (std::is_floating_point_v<T>)
+        std::fprintf(capture, "%g", static_cast<double>(value));
+    else if constexpr (std::is_signed_v<T>)
+        std::fprintf(capture, "%lld", static_cast<long long>(value));
+    else
+        std::fprintf(capture, "%llu", static_cast<unsigned long long>(value));
+}
+
+template<traced Id, typename...Args>
+unsigned long long submitted_vertices(const Args...args)
+{
+    const auto arguments = std::make_tuple(args...);
+
+    if constexpr (Id == traced::DrawElements)
+        return std::get<1>(arguments);
+    else if constexpr (Id == traced::DrawArraysInstanced)
+        return static_cast<unsigned long long>(std::get<2>(arguments)) * std::get<3>(arguments);
+    else
+        return std::get<2>(arguments);
+}
+
+template<traced Id, typename...Args>
+void record(const Args...args)
+{
+    constexpr auto kind = traced_categories[static_cast<unsigned>(Id)];
+
+    ++current.calls;
+
+    if constexpr (kind == category::draw)
+    {
+        ++current.drawCalls;
+        current.vertices += submitted_vertices<Id>(args...);
+    }
+    else if constexpr (kind == category::state)
+        ++current.stateChanges;
+    else if constexpr (kind == category::uniform)
+        ++current.uniformUploads;
+    else if constexpr (kind == category::texture)
+        ++current.textureBinds;
+
+    if (capture)
+    {
+        std::fprintf(capture, "gl%s(", traced_names[static_cast<unsigned>(Id)]);
+        [[maybe_unused]] const char* separator = "";
+        ((std::fputs(separator, capture), write_argument(args), separator = ", "), ...);
+        std::fputs(")\n", capture);
+    }
+}
+
+template<traced Id, auto& Slot, typename Proc = std::remove_reference_t<decltype(Slot)>>
+struct hook;
+
+template<traced Id, auto& Slot, typename R, typename...Args>
+struct hook<Id, Slot, R (CODEGEN_FUNCPTR *)(Args...)>
+{
+    static inline R (CODEGEN_FUNCPTR *real)(Args...) = nullptr;
+
+    static R CODEGEN_FUNCPTR call(Args...args)
+    {
+        record<Id>(args...);
+        return real(args...);
+    }
+
+    static void install()
+    {
+        if (!Slot || Slot == &call)
+            return;
+
+        real = Slot;
+        Slot = &call;
+    }
+};
+
+void begin_capture()
+{
+    char path[64];
+    std::snprintf(path, sizeof(path), "gl_trace_%u.txt", frame_index);
+
+    if (capture = std::fopen(path, "w"); !capture)
+    {
+        LOGE("Unable to open %s for the GL trace", path);
+        return;
+    }
+
+    LOGI("Capturing GL calls of frame %u to %s", frame_index, path);
+}
+
+void end_capture()
+{
+    std::fprintf(capture,
+            "# frame %u: %u calls, %u draws, %llu vertices, %u state changes, %u uniform uploads, %u texture binds\n",
+            frame_index, last.calls, last.drawCalls, last.vertices, last.stateChanges, last.uniformUploads, last.textureBinds);
+    std::fclose(capture);
+    capture = nullptr;
+}
+
+}  // namespace
+
+void Install()
+{
+#define X(name, kind) hook<traced::name, gl::name>::install();
+    IDLE_GL_TRACED(X)
+#undef X
+
+    // Lets CI capture a given frame without attaching anything to the process
+    if (const char* const frame = std::getenv("IDLE_GL_TRACE_FRAME"))
+        capture_frame = static_cast<unsigned>(std::strtoul(frame, nullptr, 10));
+
+#ifndef __ANDROID__
+    std::signal(SIGUSR1, [](int) { RequestCapture(); });
+#endif
+}
+
+void NextFrame()
+{
+    last = current;
+    current = {};
+
+    if (capture)
+        end_capture();
+
+    ++frame_index;
+
+    if (capture_requested.exchange(false, std::memory_order_relaxed) || frame_index == capture_frame)
+        begin_capture();
+}
+
+const FrameStats& LastFrame()
+{
+    return last;
+}
+
+void RequestCapture()
+{
+    capture_requested.store(true, std::memory_order_relaxed);
+}
+
+}  // namespace gl::trace
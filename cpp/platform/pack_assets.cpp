@@ -0,0 +1,205 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Bundles the loose files of a directory into an asset pack, see asset_pack.hpp
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "asset_pack.hpp"
+
+namespace
+{
+
+using file_ptr = std::unique_ptr<FILE, decltype([](FILE* f){ std::fclose(f); })>;
+
+struct source_file
+{
+    std::string name;
+    std::string contents;
+};
+
+bool skipped(const std::string_view name) noexcept
+{
+    return name.empty() || name.front() == '.' || name.ends_with(".tmp");
+}
+
+bool read_file(const std::string& path, std::string& out) noexcept
+{
+    const file_ptr f{ std::fopen(path.c_str(), "rb") };
+    if (!f)
+        return false;
+
+    char buffer[1 << 16];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f.get())) > 0;)
+        out.append(buffer, n);
+    return !std::ferror(f.get());
+}
+
+// The directory's own time covers files being added or removed
+bool is_up_to_date(const std::string& dir, const std::vector<std::string>& names, const char * const output) noexcept
+{
+    struct stat info;
+    if (::stat(output, &info) != 0)
+        return false;
+
+    const auto newer = [&info](const std::string& path)
+    {
+        struct stat source;
+        return ::stat(path.c_str(), &source) != 0 || source.st_mtime > info.st_mtime;
+    };
+
+    return !newer(dir) && std::none_of(names.begin(), names.end(),
+            [&](const std::string& name) { return newer(dir + '/' + name); });
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "usage: %s output.pak assets_directory\n", argv[0]);
+        return 2;
+    }
+
+    const char * const output = argv[1];
+    const std::string dir = argv[2];
+
+    std::vector<std::string> names;
+    {
+        const std::unique_ptr<DIR, decltype([](DIR* d){ ::closedir(d); })> listing{ ::opendir(dir.c_str()) };
+        if (!listing)
+        {
+            std::fprintf(stderr, "%s: cannot list\n", dir.c_str());
+            return 1;
+        }
+
+        while (const auto item = ::readdir(listing.get()))
+        {
+            struct stat info;
+            if (!skipped(item->d_name)
+                    && ::stat((dir + '/' + item->d_name).c_str(), &info) == 0
+                    && S_ISREG(info.st_mode))
+                names.emplace_back(item->d_name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+
+    // The game reads the converted .itx whenever it exists, its PNG would only be packed twice
+    std::erase_if(names, [&names](const std::string& name)
+        {
+            return name.ends_with(".png")
+                && std::binary_search(names.begin(), names.end(), name.substr(0, name.size() - 4) + ".itx");
+        });
+
+    if (is_up_to_date(dir, names, output))
+        return 0;
+
+    std::vector<source_file> files;
+    for (const auto& name : names)
+    {
+        auto& file = files.emplace_back(source_file{ name, {} });
+        if (!read_file(dir + '/' + name, file.contents))
+        {
+            std::fprintf(stderr, "%s/%s: cannot read\n", dir.c_str(), name.c_str());
+            return 1;
+        }
+    }
+
+    std::string names_blob;
+    for (const auto& file : files)
+        names_blob += file.name;
+
+    const auto align = [](const std::uint64_t n) { return (n + platform::pack::data_alignment - 1) & ~(platform::pack::data_alignment - 1); };
+
+    platform::pack::header header{};
+    std::memcpy(header.magic, platform::pack::header::signature, sizeof(header.magic));
+    header.version = platform::pack::header::current_version;
+    header.count = static_cast<std::uint32_t>(files.size());
+    header.names_size = static_cast<std::uint32_t>(names_blob.size());
+
+    std::vector<platform::pack::entry> entries;
+    std::uint64_t offset = align(sizeof(header) + files.size() * sizeof(platform::pack::entry) + names_blob.size());
+    std::uint32_t name_offset = 0;
+
+    for (const auto& file : files)
+    {
+        entries.push_back(platform::pack::entry{
+                name_offset, static_cast<std::uint32_t>(file.name.size()),
+                offset, file.contents.size(),
+                static_cast<std::uint32_t>(::crc32(0, reinterpret_cast<const Bytef*>(file.contents.data()), static_cast<uInt>(file.contents.size()))),
+                0 });
+        name_offset += static_cast<std::uint32_t>(file.name.size());
+        offset = align(offset + file.contents.size());
+    }
+
+    const std::string temporary = std::string{ output } + ".tmp";
+    {
+        const file_ptr f{ std::fopen(temporary.c_str(), "wb") };
+        bool ok = !!f;
+        std::uint64_t written = 0;
+
+        const auto put = [&](const void * data, const size_t size)
+        {
+            ok = ok && std::fwrite(data, 1, size, f.get()) == size;
+            written += size;
+        };
+
+        const auto pad = [&]()
+        {
+            static constexpr char zeros[platform::pack::data_alignment] {};
+            put(zeros, align(written) - written);
+        };
+
+        put(&header, sizeof(header));
+        put(entries.data(), entries.size() * sizeof(platform::pack::entry));
+        put(names_blob.data(), names_blob.size());
+
+        for (const auto& file : files)
+        {
+            pad();
+            put(file.contents.data(), file.contents.size());
+        }
+
+        if (!ok || std::fflush(f.get()) != 0)
+        {
+            std::fprintf(stderr, "%s: cannot write\n", temporary.c_str());
+            std::remove(temporary.c_str());
+            return 1;
+        }
+    }
+
+    if (std::rename(temporary.c_str(), output) != 0)
+    {
+        std::fprintf(stderr, "%s: cannot write\n", output);
+        std::remove(temporary.c_str());
+        return 1;
+    }
+
+    std::printf("%s: packed %zu files\n", output, files.size());
+    return 0;
+}
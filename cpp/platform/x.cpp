@@ -26,11 +26,18 @@
 #include "opengl_core_adaptive.hpp"
 #include <GL/glx.h>
 #include <cstdlib>
+#include <cerrno>
 #include <atomic>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include <log.hpp>
 #include "context.hpp"
 #include "asset_access.hpp"
+#include "asset_pack.hpp"
 #include <almost_cpp20.hpp>
 #include "../png/png.hpp"
 
@@ -402,48 +409,175 @@ void context::terminate_display() noexcept
     }
 }
 
+namespace
+{
+
+class asset_pack
+{
+    void * mapping = nullptr;
+    size_t length = 0;
+
+public:
+    pack::index contents;
+    time_t modified = 0;
+
+    asset_pack(const char * const path) noexcept
+    {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            LOGD("No asset pack at \"%s\", using loose files", path);
+            return;
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            modified = info.st_mtime;
+            length = static_cast<size_t>(info.st_size);
+            mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+                mapping = nullptr;
+        }
+        ::close(fd);
+
+        if (!mapping)
+            return;
+
+        if (const auto index = pack::index::open({ reinterpret_cast<const char*>(mapping), length }))
+        {
+            contents = *index;
+            LOGI("Asset pack \"%s\" mapped, %u files", path, contents.size());
+        }
+        else
+        {
+            LOGE("Asset pack \"%s\" is damaged, using loose files", path);
+        }
+    }
+
+    ~asset_pack() noexcept
+    {
+        if (mapping)
+            ::munmap(mapping, length);
+    }
+};
+
+const asset_pack& packed_assets() noexcept
+{
+    static const asset_pack instance{ "assets.pak" };
+    return instance;
+}
+
+// A loose file edited after the pack was built wins over its packed copy
+bool loose_is_newer(const std::string& full_path, const time_t pack_time) noexcept
+{
+    struct stat info;
+    return ::stat(full_path.c_str(), &info) == 0 && info.st_mtime > pack_time;
+}
+
+}  // namespace
+
+asset::asset(asset&& other) noexcept
+    : data(other.data), mapping(other.mapping)
+{
+    other.data = {};
+    other.mapping = nullptr;
+}
+
+asset::~asset() noexcept
+{
+    if (mapping)
+        ::munmap(mapping, data.size());
+}
+
 asset::operator bool() const noexcept
 {
-    return !!size;
+    return !!data.size();
 }
 
 std::string_view asset::view() const noexcept
 {
-    return { reinterpret_cast<const char*>(ptr.get()), size };
+    return data;
 }
 
-asset asset::hold(std::string path) noexcept
+asset asset::open(const char * path, const bool report_missing) noexcept
 {
-    path.insert(0, "assets/");
+    const std::string full_path = std::string{ "assets/" } + path;
+    const auto& pack = packed_assets();
 
-    if (const std::unique_ptr<FILE, decltype([](FILE* f){ std::fclose(f); })> f{ std::fopen(path.c_str(), "rb") })
+    if (const auto e = pack.contents.find(path); e && !loose_is_newer(full_path, pack.modified))
     {
-        std::fseek(f.get(), 0, SEEK_END);
-
-        const auto size = std::ftell(f.get());
-        if (size <= 0 || std::fseek(f.get(), 0, SEEK_SET) != 0)
+        const auto view = pack.contents.contents(*e);
+#ifdef DEBUG
+        if (::crc32(0, reinterpret_cast<const Bytef*>(view.data()), static_cast<uInt>(view.size())) != e->checksum)
+        {
+            LOGE("Packed \"%s\" does not match its checksum", path);
             return {};
+        }
+#endif
+        return { view, nullptr };
+    }
 
-        LOGD("\"%s\" - loaded %ld %s",
-                path.c_str(),
-                size >= 1024 ? size / 1024 : size,
-                size >= 1024 ? "KB" : "bytes");
+    if (const int fd = ::open(full_path.c_str(), O_RDONLY | O_CLOEXEC); fd >= 0)
+    {
+        struct stat info;
+        void * mapping = MAP_FAILED;
+
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+            mapping = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
 
-        auto ptr = std::make_unique<unsigned char[]>(size);
+        ::close(fd);
 
-        if (std::fread(ptr.get(), 1, size, f.get()) == static_cast<size_t>(size))
+        if (mapping != MAP_FAILED)
         {
-            return { std::move(ptr), static_cast<size_t>(size) };
+            const auto size = info.st_size;
+            LOGD("\"%s\" - mapped %ld %s",
+                    full_path.c_str(),
+                    size >= 1024 ? size / 1024 : size,
+                    size >= 1024 ? "KB" : "bytes");
+
+            return { { reinterpret_cast<const char*>(mapping), static_cast<size_t>(size) }, mapping };
         }
     }
+    else if (!report_missing && errno == ENOENT)
+    {
+        return {};
+    }
 
-    LOGE("Couldn't get a hold of \"%s\"", path.c_str());
+    LOGE("Couldn't get a hold of \"%s\"", full_path.c_str());
     return {};
 }
 
-asset asset::hold(const char * path) noexcept
+std::string cache_path(const std::string_view file_name) noexcept
 {
-    return hold(std::string{path});
+    std::string path;
+
+    if (const char * xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    {
+        path = xdg;
+    }
+    else if (const char * home = std::getenv("HOME"); home && *home)
+    {
+        path = home;
+        path += "/.cache";
+        ::mkdir(path.c_str(), 0755);
+    }
+    else
+    {
+        return {};
+    }
+
+    path += "/idle";
+
+    if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        LOGW("Cache directory \"%s\" is unavailable", path.c_str());
+        return {};
+    }
+
+    path += '/';
+    path += file_name;
+    return path;
 }
 
 }  // namespace platform
@@ -0,0 +1,140 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <log.hpp>
+
+#include "atlas.hpp"
+
+namespace idle::images
+{
+
+atlas& atlas::shared() noexcept
+{
+    static atlas instance;
+    return instance;
+}
+
+bool atlas::accepts(const unsigned width, const unsigned height, const GLint quality) noexcept
+{
+    return width <= max_side && height <= max_side
+        && (quality == gl::NEAREST || quality == gl::LINEAR);
+}
+
+void atlas::place(loader& uploader,
+        const unsigned char * const pixels, const unsigned width, const unsigned height,
+        const unsigned stride, const unsigned channels, const GLint quality,
+        placed_callback placed) noexcept
+{
+    const unsigned w = width + gutter * 2, h = height + gutter * 2;
+    auto block = std::make_unique<unsigned char[]>(w * h * 4);
+
+    // Edge texels are repeated into the gutter so that filtering never reaches a neighbour
+    for (unsigned y = 0; y < h; ++y)
+    {
+        const auto src_row = pixels + (std::clamp(y, gutter, height + gutter - 1) - gutter) * stride * channels;
+        auto dst = block.get() + y * w * 4;
+
+        for (unsigned x = 0; x < w; ++x, dst += 4)
+        {
+            const auto src = src_row + (std::clamp(x, gutter, width + gutter - 1) - gutter) * channels;
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = channels > 3 ? src[3] : 0xff;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& p : pages)
+        {
+            if (p.quality == quality)
+                if (const auto rect = p.packer.allocate(w, h))
+                {
+                    upload(uploader, { p.texture, rect->x, rect->y, rect->width, rect->height },
+                            width, height, std::move(block), std::move(placed));
+                    return;
+                }
+        }
+    }
+
+    // The page is opened by the GL thread, the picture follows it through the queue
+    uploader.queue_upload(page_size, page_size, gl::RGBA, gl::RGBA, quality, gl::CLAMP_TO_EDGE, {},
+            [this, &uploader, quality, width, height,
+                block = std::make_shared<std::unique_ptr<unsigned char[]>>(std::move(block)),
+                placed = std::move(placed)](const GLuint tex) mutable
+            {
+                if (!tex)
+                {
+                    placed({}, {});
+                    return;
+                }
+
+                LOGD("New atlas page %u", tex);
+                atlas_region spot;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto& p = pages.emplace_back(page{ tex, quality, shelf_packer{ page_size } });
+                    const auto rect = p.packer.allocate(width + gutter * 2, height + gutter * 2);
+                    spot = { tex, rect->x, rect->y, rect->width, rect->height };
+                }
+                upload(uploader, spot, width, height, std::move(*block), std::move(placed));
+            });
+}
+
+void atlas::upload(loader& uploader, const atlas_region& spot,
+        const unsigned width, const unsigned height,
+        std::unique_ptr<unsigned char[]> block, placed_callback placed) noexcept
+{
+    constexpr float side = page_size;
+    const texture out
+    {
+        spot.page,
+        { width / side, height / side },
+        { (spot.x + gutter) / side, (spot.y + gutter) / side }
+    };
+
+    // A dropped upload still hands the region over, so that it gets released with the rest
+    uploader.queue_upload_into(spot.page,
+            static_cast<GLint>(spot.x), static_cast<GLint>(spot.y),
+            static_cast<GLsizei>(spot.width), static_cast<GLsizei>(spot.height),
+            gl::RGBA, std::move(block),
+            [spot, out, done = std::move(placed)](const GLuint tex) { done(spot, tex ? out : texture{}); });
+}
+
+GLuint atlas::release(const atlas_region& r) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto p = std::find_if(pages.begin(), pages.end(), [&r](const page& it) { return it.texture == r.page; });
+    if (p == pages.end())
+        return 0;
+
+    p->packer.release({ r.x, r.y, r.width, r.height });
+    if (!p->packer.empty())
+        return 0;
+
+    const GLuint tex = p->texture;
+    pages.erase(p);
+    LOGD("Atlas page %u is empty", tex);
+    return tex;
+}
+
+}  // namespace idle::images
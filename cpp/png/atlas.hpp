@@ -0,0 +1,74 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <math_defines.hpp>
+#include "image_queue.hpp"
+#include "shelf_packer.hpp"
+
+namespace idle::images
+{
+
+// Small pictures share a few large pages instead of getting a power-of-two texture each.
+// Pages are kept per filtering mode and handed back once their last region is released.
+class atlas
+{
+public:
+    static constexpr unsigned page_size = 1024, max_side = 256, gutter = 1;
+
+    static atlas& shared() noexcept;
+
+    static bool accepts(unsigned width, unsigned height, GLint quality) noexcept;
+
+    // Called on the GL thread once the picture is in its page, or with an empty texture
+    // if the upload was dropped; a region with a page has to be released either way
+    using placed_callback = std::function<void(const atlas_region&, const texture&)>;
+
+    // Never waits, a new page is opened through the upload queue as well
+    void place(loader& uploader,
+            const unsigned char * pixels, unsigned width, unsigned height,
+            unsigned stride, unsigned channels, GLint quality,
+            placed_callback placed) noexcept;
+
+    // Returns the page texture if it became empty and has to be deleted
+    GLuint release(const atlas_region& r) noexcept;
+
+private:
+    struct page
+    {
+        GLuint texture;
+        GLint quality;
+        shelf_packer packer;
+    };
+
+    std::mutex mutex;
+    std::vector<page> pages;
+
+    static void upload(loader& uploader, const atlas_region& spot,
+            unsigned width, unsigned height,
+            std::unique_ptr<unsigned char[]> block, placed_callback placed) noexcept;
+};
+
+}  // namespace idle::images
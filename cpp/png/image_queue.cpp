@@ -17,81 +17,203 @@
     along with Idle. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <atomic>
+#include <thread>
 #include <log.hpp>
 
 #include "image_queue.hpp"
+#include "atlas.hpp"
 #include "png.hpp"
+#include "texture_file.hpp"
 
 namespace idle::images
 {
 
-texture database::load_from_assets(const char * filename, GLint quality) noexcept
+namespace
+{
+
+std::atomic_bool npot = false;
+
+}  // namespace
+
+void set_npot_support(const bool supported) noexcept
+{
+    npot.store(supported, std::memory_order_relaxed);
+}
+
+bool npot_supported() noexcept
+{
+    return npot.load(std::memory_order_relaxed);
+}
+
+void database::request(const char * filename, GLint quality, ready_callback on_ready) noexcept
 {
     const std::string_view fn_view(filename);
     {
-        std::lock_guard<std::mutex> lock(map_mutex);
+        std::unique_lock<std::mutex> lock(map_mutex);
         const auto iter = map.find(fn_view);
         if (iter != map.end())
         {
-            return iter->second;
+            const texture out = iter->second;
+            lock.unlock();
+            on_ready(out);
+            return;
+        }
+
+        if (const auto pending = in_flight.find(fn_view); pending != in_flight.end())
+        {
+            LOGDD("'%s' is already on its way", filename);
+            pending->second.push_back(std::move(on_ready));
+            return;
         }
+        in_flight[fn_view].push_back(std::move(on_ready));
     }
 
+    decode(filename, quality);
+}
+
+void database::finish(const std::string_view fn, const texture& tex, const atlas_region& region) noexcept
+{
+    std::vector<ready_callback> waiting;
     {
-        png_image_data picture(filename);
+        std::lock_guard<std::mutex> lock(map_mutex);
+        if (region.page)
+            regions.push_back(region);
+        if (tex.id)
+            map.try_emplace(fn, tex);
 
-        if (!picture.image)
+        if (const auto pending = in_flight.find(fn); pending != in_flight.end())
         {
-            LOGE("Failed to load '%s'", filename);
-            return {};
+            waiting = std::move(pending->second);
+            in_flight.erase(pending);
+        }
+    }
+
+    for (const auto& on_ready : waiting)
+        on_ready(tex);
+}
+
+void database::decode(const char * filename, GLint quality) noexcept
+{
+    const std::string_view fn_view(filename);
+
+    if (auto converted = texture_file::open(filename, !npot_supported()))
+    {
+        if (atlas::accepts(converted->width, converted->height, quality))
+        {
+            atlas::shared().place(*this,
+                    converted->pixels, converted->width, converted->height,
+                    converted->stored_width, converted->channels, quality,
+                    [this, fn_view](const atlas_region& r, const texture& tex) { finish(fn_view, tex, r); });
+            return;
         }
 
-        LOGDD("Queuing '%s' texture creation", filename);
+        LOGDD("Queuing converted '%s' texture creation", filename);
+
+        const auto format = converted->channels > 3 ? gl::RGBA : gl::RGB;
+        const point_t area
+        {
+            static_cast<float>(converted->width) / static_cast<float>(converted->stored_width),
+            static_cast<float>(converted->height) / static_cast<float>(converted->stored_height)
+        };
 
-        const auto format = picture.size > 3 ? gl::RGBA : gl::RGB;
-        const GLuint tex = load_from_memory(
-                picture.real_width,
-                picture.real_height,
+        queue_upload(
+                converted->stored_width,
+                converted->stored_height,
                 format,
                 static_cast<GLenum>(format),
                 quality,
                 gl::CLAMP_TO_EDGE,
-                std::move(picture.image));
+                converted->pixels,
+                std::move(converted->storage),
+                [this, fn_view, area](const GLuint tex) { finish(fn_view, texture{ tex, area }); });
+        return;
+    }
 
-        const texture out
-        {
-            tex,
-            {
-                static_cast<float>(picture.width) / static_cast<float>(picture.real_width),
-                static_cast<float>(picture.height) / static_cast<float>(picture.real_height)
-            }
-        };
-        std::lock_guard<std::mutex> lock(map_mutex);
-        map.try_emplace(fn_view, out);
-        return out;
+    png_image_data picture(filename, !npot_supported());
+
+    if (!picture.image)
+    {
+        LOGE("Failed to load '%s'", filename);
+        finish(fn_view, {});
+        return;
     }
+
+    if (atlas::accepts(picture.width, picture.height, quality))
+    {
+        LOGDD("Packing '%s' into the atlas", filename);
+        atlas::shared().place(*this,
+                picture.image.get(), picture.width, picture.height,
+                picture.real_width, picture.size, quality,
+                [this, fn_view](const atlas_region& r, const texture& tex) { finish(fn_view, tex, r); });
+        return;
+    }
+
+    LOGDD("Queuing '%s' texture creation", filename);
+
+    const auto format = picture.size > 3 ? gl::RGBA : gl::RGB;
+    const point_t area
+    {
+        static_cast<float>(picture.width) / static_cast<float>(picture.real_width),
+        static_cast<float>(picture.height) / static_cast<float>(picture.real_height)
+    };
+
+    queue_upload(
+            picture.real_width,
+            picture.real_height,
+            format,
+            static_cast<GLenum>(format),
+            quality,
+            gl::CLAMP_TO_EDGE,
+            std::move(picture.image),
+            [this, fn_view, area](const GLuint tex) { finish(fn_view, texture{ tex, area }); });
 }
 
-GLuint loader::load_from_memory(GLsizei w, GLsizei h,
+void loader::queue_upload(GLsizei w, GLsizei h,
             GLint i, GLenum f,
             GLint q, GLint r,
-            std::unique_ptr<unsigned char[]> pix) noexcept
+            std::unique_ptr<unsigned char[]> pix,
+            completion done) noexcept
 {
-    std::promise<GLuint> promise;
-    auto tex_id = promise.get_future();
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        load_queue.emplace(
-                w, h, i, f, q, r,
-                std::move(pix), std::move(promise));
-    }
-    return tex_id.get();
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    load_queue.emplace(
+            w, h, i, f, q, r,
+            std::move(pix), std::move(done));
 }
 
-void loader::load_topmost_queued_picture() noexcept
+void loader::queue_upload(GLsizei w, GLsizei h,
+            GLint i, GLenum f,
+            GLint q, GLint r,
+            const unsigned char * pix,
+            std::shared_ptr<const void> owner,
+            completion done) noexcept
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    auto& recipe = load_queue.emplace(
+            w, h, i, f, q, r,
+            nullptr, std::move(done));
+    recipe.owner = std::move(owner);
+    recipe.borrowed = pix;
+}
+
+void loader::queue_upload_into(GLuint target, GLint x, GLint y,
+            GLsizei w, GLsizei h, GLenum f,
+            std::unique_ptr<unsigned char[]> pix,
+            completion done) noexcept
 {
-    if (auto td = [this]()->std::optional<recipe_data>
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    auto& recipe = load_queue.emplace(
+            w, h, static_cast<GLint>(f), f, 0, 0,
+            std::move(pix), std::move(done));
+    recipe.target = target;
+    recipe.x = x;
+    recipe.y = y;
+}
+
+bool loader::load_topmost_queued_picture() noexcept
+{
+    auto td = [this]()->std::optional<recipe_data>
         {
             std::lock_guard<std::mutex> lock(queue_mutex);
             if (!!load_queue.size())
@@ -102,27 +224,70 @@ void loader::load_topmost_queued_picture() noexcept
                 return { std::move(t) };
             }
             return {};
-        }())
-    {
-        GLuint tex;
-        gl::GenTextures(1, &tex);
-        gl::BindTexture(gl::TEXTURE_2D, tex);
+        }();
 
-        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, td->quality);
-        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, td->quality != gl::NEAREST ? gl::LINEAR : gl::NEAREST);
-        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, td->repeat);
-        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, td->repeat);
-        gl::TexImage2D(gl::TEXTURE_2D, 0, td->internalformat, td->width, td->height, 0, td->format, gl::UNSIGNED_BYTE, td->pixels.get());
+    if (!td)
+        return false;
 
+    const unsigned char * const pixels = td->pixels ? td->pixels.get() : td->borrowed;
+
+    if (td->target)
+    {
+        gl::BindTexture(gl::TEXTURE_2D, td->target);
+        gl::TexSubImage2D(gl::TEXTURE_2D, 0, td->x, td->y, td->width, td->height, td->format, gl::UNSIGNED_BYTE, pixels);
         gl::BindTexture(gl::TEXTURE_2D, 0);
+        td->done(td->target);
+        return true;
+    }
 
-        LOGDD("Tex id = %u", tex);
-        td->promise.set_value(tex);
+    GLuint tex;
+    gl::GenTextures(1, &tex);
+    gl::BindTexture(gl::TEXTURE_2D, tex);
+
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, td->quality);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, magnification_filter(td->quality));
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, td->repeat);
+    gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, td->repeat);
+    gl::TexImage2D(gl::TEXTURE_2D, 0, td->internalformat, td->width, td->height, 0, td->format, gl::UNSIGNED_BYTE, pixels);
+
+    if (is_mipmapped(td->quality) && pixels)
+        gl::GenerateMipmap(gl::TEXTURE_2D);
+
+    gl::BindTexture(gl::TEXTURE_2D, 0);
+
+    LOGDD("Tex id = %u", tex);
+    td->done(tex);
+    return true;
+}
+
+void loader::drop_queued_uploads() noexcept
+{
+    std::queue<recipe_data> dropped;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        dropped.swap(load_queue);
     }
+
+    if (dropped.size())
+        LOGD("Dropping %zu queued uploads", dropped.size());
+
+    for (; !dropped.empty(); dropped.pop())
+        dropped.front().done(0);
+}
+
+void loader::load_queued_pictures(const std::chrono::microseconds budget) noexcept
+{
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    while (load_topmost_queued_picture() && std::chrono::steady_clock::now() < deadline);
 }
 
 database::~database() noexcept
 {
+    {
+        // Whoever waits is being torn down as well
+        std::lock_guard<std::mutex> lock(map_mutex);
+        in_flight.clear();
+    }
     destroy_textures();
 }
 
@@ -130,30 +295,53 @@ namespace
 {
 
 std::atomic<unsigned> trash_size = 0;
-std::unique_ptr<GLuint[]> trash_content;
+std::vector<GLuint> trash_content;
 
 }  // namespace
 
 void database::destroy_textures() noexcept
 {
-    std::unique_lock<std::mutex> lock(map_mutex);
-    if (!map.size()) return;
+    // Queued uploads would land in textures that are about to go, atlas regions included
+    drop_queued_uploads();
 
-    const auto size = map.size();
-    auto out = std::make_unique<GLuint[]>(size);
-    auto ptr = out.get();
-    for (const auto& it : map)
+    std::vector<GLuint> out;
+    std::vector<ready_callback> orphaned;
     {
-        LOGDD("Marking tex %u for destruction", it.second.id);
-        *ptr++ = it.second.id;
+        std::lock_guard<std::mutex> lock(map_mutex);
+        out.reserve(map.size() + regions.size());
+
+        for (const auto& it : map)
+        {
+            if (std::any_of(regions.begin(), regions.end(), [&it](const atlas_region& r) { return r.page == it.second.id; }))
+                continue;
+            LOGDD("Marking tex %u for destruction", it.second.id);
+            out.push_back(it.second.id);
+        }
+        for (const auto& r : regions)
+        {
+            if (const GLuint page = atlas::shared().release(r))
+                out.push_back(page);
+        }
+        for (auto& pending : in_flight)
+        {
+            for (auto& on_ready : pending.second)
+                orphaned.push_back(std::move(on_ready));
+        }
+        map.clear();
+        regions.clear();
+        in_flight.clear();
     }
-    map.clear();
-    lock.unlock();
+
+    for (const auto& on_ready : orphaned)
+        on_ready({});
+
+    if (out.empty()) return;
 
     while (!!trash_size.load(std::memory_order_acquire)) std::this_thread::yield();
 
+    const auto size = static_cast<unsigned>(out.size());
     trash_content = std::move(out);
-    trash_size.store(static_cast<unsigned>(size), std::memory_order_release);
+    trash_size.store(size, std::memory_order_release);
 }
 
 void database::clean_trash() noexcept
@@ -161,8 +349,8 @@ void database::clean_trash() noexcept
     if (const auto size = trash_size.load(std::memory_order_acquire))
     {
         LOGDD("Deleting %u textures", size);
-        gl::DeleteTextures(size, trash_content.get());
-        trash_content.reset(nullptr);
+        gl::DeleteTextures(size, trash_content.data());
+        trash_content.clear();
         trash_size.store(0, std::memory_order_release);
     }
 }
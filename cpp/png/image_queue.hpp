@@ -18,20 +18,43 @@
 */
 
 #pragma once
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include <string_view>
 #include <mutex>
-#include <future>
 #include <queue>
+#include <vector>
 
 #include <math_defines.hpp>
 
 namespace idle::images
 {
 
+// Written on the GL thread during setup, read by the decoding threads
+void set_npot_support(bool supported) noexcept;
+
+bool npot_supported() noexcept;
+
+constexpr bool is_mipmapped(const GLint quality) noexcept
+{
+    return quality != gl::NEAREST && quality != gl::LINEAR;
+}
+
+constexpr GLint magnification_filter(const GLint quality) noexcept
+{
+    return quality == gl::NEAREST || quality == gl::NEAREST_MIPMAP_NEAREST || quality == gl::NEAREST_MIPMAP_LINEAR
+        ? gl::NEAREST : gl::LINEAR;
+}
+
 struct loader
 {
+    // Runs on the GL thread once the pixels are in the texture
+    using completion = std::function<void(GLuint)>;
+
+    static constexpr std::chrono::microseconds frame_budget{ 4000 };
+
 private:
     struct recipe_data
     {
@@ -40,21 +63,24 @@ private:
         GLenum format;
         GLint quality, repeat;
         std::unique_ptr<unsigned char[]> pixels;
-        std::promise<GLuint> promise;
-        GLenum error;
+        std::shared_ptr<const void> owner;
+        const unsigned char * borrowed = nullptr;
+        completion done;
+        GLuint target = 0;
+        GLint x = 0, y = 0;
 
-        template<typename Pixels, typename Promise>
+        template<typename Pixels, typename Completion>
         recipe_data(GLsizei w, GLsizei h,
                 GLint i, GLenum f,
                 GLint q, GLint r,
                 Pixels&& pix,
-                Promise&& prom
+                Completion&& comp
             ) noexcept :
             width(w), height(h),
             internalformat(i), format(f),
             quality(q), repeat(r),
             pixels(std::forward<Pixels>(pix)),
-            promise(std::forward<Promise>(prom))
+            done(std::forward<Completion>(comp))
         {}
     };
 
@@ -62,28 +88,66 @@ private:
     std::queue<recipe_data> load_queue;
 
 public:
-    GLuint load_from_memory(GLsizei w, GLsizei h,
+    void queue_upload(GLsizei w, GLsizei h,
+                GLint i, GLenum f,
+                GLint q, GLint r,
+                std::unique_ptr<unsigned char[]> pix,
+                completion done) noexcept;
+
+    // Uploads memory that owner keeps alive, such as a mapped file
+    void queue_upload(GLsizei w, GLsizei h,
                 GLint i, GLenum f,
                 GLint q, GLint r,
-                std::unique_ptr<unsigned char[]> pix) noexcept;
+                const unsigned char * pix,
+                std::shared_ptr<const void> owner,
+                completion done) noexcept;
+
+    // Fills a part of an existing texture
+    void queue_upload_into(GLuint target, GLint x, GLint y,
+                GLsizei w, GLsizei h, GLenum f,
+                std::unique_ptr<unsigned char[]> pix,
+                completion done) noexcept;
+
+    bool load_topmost_queued_picture() noexcept;
 
-    void load_topmost_queued_picture() noexcept;
+    // Forgets queued uploads, their completions get a zero texture
+    void drop_queued_uploads() noexcept;
+
+    // Always uploads at least one picture, then keeps going while the budget lasts
+    void load_queued_pictures(std::chrono::microseconds budget = frame_budget) noexcept;
 };
 
 struct texture
 {
     GLuint id = 0;
     point_t area{ 1, 1 };
+    point_t offset{ 0, 0 };
+};
+
+struct atlas_region
+{
+    GLuint page = 0;
+    unsigned x = 0, y = 0, width = 0, height = 0;
 };
 
 struct database : loader
 {
+    using ready_callback = std::function<void(const texture&)>;
+
 private:
     std::mutex map_mutex;
     std::unordered_map<std::string_view, texture> map;
+    std::vector<atlas_region> regions;
+    std::unordered_map<std::string_view, std::vector<ready_callback>> in_flight;
+
+    void decode(const char * fn, GLint quality) noexcept;
+
+    void finish(std::string_view fn, const texture& tex, const atlas_region& region = {}) noexcept;
 
 public:
-    texture load_from_assets(const char * fn, GLint quality = gl::LINEAR) noexcept;
+    // Decodes on the calling thread without waiting for the upload, on_ready runs
+    // right away for known pictures and on the GL thread for new ones
+    void request(const char * fn, GLint quality, ready_callback on_ready) noexcept;
 
     ~database() noexcept;
 
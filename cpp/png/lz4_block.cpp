@@ -0,0 +1,176 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "lz4_block.hpp"
+
+namespace idle::images
+{
+namespace
+{
+
+constexpr std::size_t min_match = 4, last_literals = 5, match_search_limit = 12;
+constexpr unsigned hash_bits = 12;
+
+std::uint32_t read32(const unsigned char * const p) noexcept
+{
+    std::uint32_t v;
+    ::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void write_length(std::vector<unsigned char>& out, std::size_t n) noexcept
+{
+    for (; n >= 255; n -= 255)
+        out.push_back(255);
+    out.push_back(static_cast<unsigned char>(n));
+}
+
+void write_sequence(std::vector<unsigned char>& out, const unsigned char * const literals, const std::size_t literal_count, const std::size_t offset, const std::size_t match_length) noexcept
+{
+    const auto extra = match_length ? match_length - min_match : 0;
+    out.push_back(static_cast<unsigned char>((literal_count < 15 ? literal_count : 15) << 4 | (extra < 15 ? extra : 15)));
+
+    if (literal_count >= 15)
+        write_length(out, literal_count - 15);
+
+    out.insert(out.end(), literals, literals + literal_count);
+
+    if (!match_length)
+        return;
+
+    out.push_back(static_cast<unsigned char>(offset & 0xff));
+    out.push_back(static_cast<unsigned char>(offset >> 8));
+
+    if (extra >= 15)
+        write_length(out, extra - 15);
+}
+
+bool read_length(const unsigned char *& ip, const unsigned char * const end, std::size_t& n) noexcept
+{
+    unsigned char b;
+    do
+    {
+        if (ip == end)
+            return false;
+        b = *ip++;
+        n += b;
+    }
+    while (b == 255);
+    return true;
+}
+
+}  // namespace
+
+std::vector<unsigned char> lz4_compress(const unsigned char * const source, const std::size_t size) noexcept
+{
+    std::vector<unsigned char> out;
+    out.reserve(size / 2 + 16);
+
+    constexpr auto unused = static_cast<std::size_t>(-1);
+    const auto table = std::make_unique<std::size_t[]>(std::size_t{ 1 } << hash_bits);
+    std::fill_n(table.get(), std::size_t{ 1 } << hash_bits, unused);
+
+    std::size_t anchor = 0, i = 0;
+    const std::size_t search_end = size > match_search_limit ? size - match_search_limit : 0;
+
+    // Greedy and single-probe, decoding speed is what matters here
+    while (i < search_end)
+    {
+        const auto sequence = read32(source + i);
+        const auto slot = (sequence * 2654435761u) >> (32 - hash_bits);
+        const auto candidate = table[slot];
+        table[slot] = i;
+
+        if (candidate == unused || i - candidate > 0xffff || read32(source + candidate) != sequence)
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t length = min_match;
+        while (i + length < size - last_literals && source[candidate + length] == source[i + length])
+            ++length;
+
+        write_sequence(out, source + anchor, i - anchor, i - candidate, length);
+        i += length;
+        anchor = i;
+    }
+
+    write_sequence(out, source + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool lz4_decompress(const unsigned char * source, const std::size_t size, unsigned char * const out, const std::size_t out_size) noexcept
+{
+    const auto end = source + size;
+    const auto out_end = out + out_size;
+    auto op = out;
+
+    while (source < end)
+    {
+        const unsigned token = *source++;
+
+        std::size_t literal_count = token >> 4;
+        if (literal_count == 15 && !read_length(source, end, literal_count))
+            return false;
+
+        if (literal_count > static_cast<std::size_t>(end - source) || literal_count > static_cast<std::size_t>(out_end - op))
+            return false;
+
+        ::memcpy(op, source, literal_count);
+        op += literal_count;
+        source += literal_count;
+
+        if (source == end)
+            break;
+
+        if (end - source < 2)
+            return false;
+
+        const std::size_t offset = source[0] | source[1] << 8;
+        source += 2;
+
+        if (!offset || offset > static_cast<std::size_t>(op - out))
+            return false;
+
+        std::size_t length = token & 15;
+        if (length == 15 && !read_length(source, end, length))
+            return false;
+
+        length += min_match;
+        if (length > static_cast<std::size_t>(out_end - op))
+            return false;
+
+        // Byte by byte, since the match may overlap what it produces
+        const auto match = op - offset;
+        for (std::size_t k = 0; k < length; ++k)
+            op[k] = match[k];
+        op += length;
+    }
+
+    return op == out_end;
+}
+
+}  // namespace idle::images
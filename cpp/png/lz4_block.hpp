@@ -0,0 +1,35 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace idle::images
+{
+
+// Plain LZ4 block format, no frame around it: the sizes are kept by whoever stores the block
+
+std::vector<unsigned char> lz4_compress(const unsigned char * source, std::size_t size) noexcept;
+
+// Fails unless the block expands to exactly out_size bytes
+bool lz4_decompress(const unsigned char * source, std::size_t size, unsigned char * out, std::size_t out_size) noexcept;
+
+}  // namespace idle::images
@@ -17,9 +17,12 @@
     along with Idle. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
 #include <zlib.hpp>
 #include "png.hpp"
-#include "../platform/asset_access.hpp"
+#include <log.hpp>
 #include <lodepng.h>
 
 namespace idle
@@ -45,12 +48,71 @@ unsigned wasteful_zlib_decompress(unsigned char** out_ptr, size_t* out_size,
     return 1;
 }
 
-bool verify_file_extension(const char * const fn) noexcept
+constexpr unsigned char png_signature[8] { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+std::uint32_t read_be32(const char * const p) noexcept
+{
+    const auto b = reinterpret_cast<const unsigned char*>(p);
+    return std::uint32_t{ b[0] } << 24 | std::uint32_t{ b[1] } << 16 | std::uint32_t{ b[2] } << 8 | b[3];
+}
+
+struct chunk
+{
+    std::string_view type, data;
+};
+
+std::optional<chunk> next_chunk(std::string_view& source) noexcept
+{
+    if (source.size() < 12)
+        return {};
+
+    const auto length = read_be32(source.data());
+    if (length > source.size() - 12)
+        return {};
+
+    const chunk out{ source.substr(4, 4), source.substr(8, length) };
+    source.remove_prefix(12 + length);
+    return out;
+}
+
+unsigned char paeth(const int a, const int b, const int c) noexcept
 {
-    auto chk = fn;
-    for (; *chk; ++chk);
-    for (; chk != fn && *chk != '.'; --chk);
-    return ::strcmp(chk, ".png") == 0;
+    const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return static_cast<unsigned char>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Reverses the scanline filter in place, prev being the already restored row above
+bool unfilter(unsigned char * const row, const unsigned char * const prev, const unsigned length, const unsigned bpp, const unsigned char filter) noexcept
+{
+    switch (filter)
+    {
+        case 0:
+            return true;
+
+        case 1:
+            for (unsigned i = bpp; i < length; ++i)
+                row[i] += row[i - bpp];
+            return true;
+
+        case 2:
+            if (prev)
+                for (unsigned i = 0; i < length; ++i)
+                    row[i] += prev[i];
+            return true;
+
+        case 3:
+            for (unsigned i = 0; i < length; ++i)
+                row[i] += ((i >= bpp ? row[i - bpp] : 0) + (prev ? prev[i] : 0)) / 2;
+            return true;
+
+        case 4:
+            for (unsigned i = 0; i < length; ++i)
+                row[i] += paeth(i >= bpp ? row[i - bpp] : 0, prev ? prev[i] : 0, i >= bpp && prev ? prev[i - bpp] : 0);
+            return true;
+
+        default:
+            return false;
+    }
 }
 
 }  // namespace
@@ -75,11 +137,153 @@ std::vector<unsigned char> png_base_data::decode_png_buffer(const unsigned char
     return out;
 }
 
-void png_image_data::decode(const std::string_view source) noexcept
+bool png_image_data::decode_streamed(std::string_view source, const bool pad) noexcept
+{
+    if (source.size() < sizeof(png_signature) || ::memcmp(source.data(), png_signature, sizeof(png_signature)) != 0)
+        return false;
+
+    source.remove_prefix(sizeof(png_signature));
+    const auto header = next_chunk(source);
+    if (!header || header->type != "IHDR" || header->data.size() != 13)
+        return false;
+
+    const auto& ihdr = header->data;
+    const unsigned w = read_be32(ihdr.data()), h = read_be32(ihdr.data() + 4);
+    const auto depth = ihdr[8], colour = ihdr[9];
+
+    // Only plain 8-bit RGB and RGBA get streamed, anything else takes the lodepng route
+    if (depth != 8 || (colour != 2 && colour != 6) || ihdr[10] || ihdr[11] || ihdr[12]
+            || !w || !h || w > (1u << 14) || h > (1u << 14))
+        return false;
+
+    const unsigned bpp = colour == 6 ? 4 : 3;
+    unsigned rw = 1, rh = 1;
+    if (pad)
+    {
+        while (rw < w) rw *= 2;
+        while (rh < h) rh *= 2;
+    }
+    else
+    {
+        rw = w;
+        rh = h;
+    }
+
+    const unsigned row_length = w * bpp, stride = rw * bpp;
+    std::unique_ptr<unsigned char[]> pixels{ new unsigned char[size_t{ stride } * rh] };
+
+    z_stream strm{};
+    if (inflateInit(&strm) != Z_OK)
+        return false;
+
+    unsigned y = 0;
+    unsigned char filter = 0;
+    bool in_row = false;
+    strm.next_out = &filter;
+    strm.avail_out = 1;
+
+    const auto advance = [&]() -> bool
+    {
+        const auto row = pixels.get() + size_t{ stride } * y;
+        if (!in_row)
+        {
+            strm.next_out = row;
+            strm.avail_out = row_length;
+            in_row = true;
+            return true;
+        }
+
+        if (!unfilter(row, y ? row - stride : nullptr, row_length, bpp, filter))
+            return false;
+
+        if (rw > w)
+            ::memset(row + row_length, 0, stride - row_length);
+
+        ++y;
+        strm.next_out = &filter;
+        strm.avail_out = 1;
+        in_row = false;
+        return true;
+    };
+
+    bool broken = false;
+    while (!broken && y < h)
+    {
+        const auto c = next_chunk(source);
+        if (!c || c->type == "IEND")
+            break;
+
+        if (c->type != "IDAT")
+            continue;
+
+        strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(c->data.data()));
+        strm.avail_in = static_cast<uInt>(c->data.size());
+
+        while (y < h)
+        {
+            const int ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            {
+                broken = true;
+                break;
+            }
+
+            if (strm.avail_out)
+                break;
+
+            if (!advance())
+            {
+                broken = true;
+                break;
+            }
+        }
+    }
+    inflateEnd(&strm);
+
+    if (y < h)
+    {
+        LOGE("Truncated or corrupt PNG data (%u of %u rows)", y, h);
+        return false;
+    }
+
+    if (rh > h)
+        ::memset(pixels.get() + size_t{ stride } * h, 0, size_t{ stride } * (rh - h));
+
+    width = w;
+    height = h;
+    size = bpp;
+    real_width = rw;
+    real_height = rh;
+    image = std::move(pixels);
+    return true;
+}
+
+void png_image_data::decode(const std::string_view source, const bool pad) noexcept
 {
+    if (decode_streamed(source, pad))
+        return;
+
     constexpr unsigned source_size = 4;
     if (const auto temp = decode_png_buffer(reinterpret_cast<const unsigned char*>(source.data()), source.size()); !!temp.size())
     {
+        if (!pad)
+        {
+            real_width = width;
+            real_height = height;
+            image = std::make_unique<unsigned char[]>(width * height * size);
+
+            if (source_size != size)
+            {
+                for (unsigned i = 0; i < width * height; ++i)
+                    ::memcpy(image.get() + size * i, temp.data() + source_size * i, size);
+            }
+            else
+            {
+                ::memcpy(image.get(), temp.data(), source_size * width * height);
+            }
+            return;
+        }
+
         while (real_width < width) real_width *= 2;
         while (real_height < height) real_height *= 2;
 
@@ -108,16 +312,11 @@ void png_image_data::decode(const std::string_view source) noexcept
     }
 }
 
-png_image_data::png_image_data(const char * fn) noexcept
+png_image_data png_image_data::from_memory(const std::string_view source, const bool pad_to_power_of_two) noexcept
 {
-    if (verify_file_extension(fn))
-    {
-        if (const auto b = platform::asset::hold(fn))
-        {
-            decode(b.view());
-        }
-    }
+    png_image_data out;
+    out.decode(source, pad_to_power_of_two);
+    return out;
 }
 
-
 }  // namespace idle
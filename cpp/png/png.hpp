@@ -40,10 +40,17 @@ struct png_image_data : png_base_data
     unsigned real_width = 1, real_height = 1;
 
 private:
-    void decode(const std::string_view source) noexcept;
+    png_image_data() noexcept = default;
+
+    void decode(const std::string_view source, bool pad) noexcept;
+
+    bool decode_streamed(const std::string_view source, bool pad) noexcept;
 
 public:
-    png_image_data(const char* filename) noexcept;
+    // Without padding the rows are stored tightly and real_* match the picture size
+    png_image_data(const char* filename, bool pad_to_power_of_two = true) noexcept;
+
+    static png_image_data from_memory(const std::string_view source, bool pad_to_power_of_two = true) noexcept;
 };
 
 }  // namespace idle
@@ -0,0 +1,51 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+#include "png.hpp"
+#include "../platform/asset_access.hpp"
+
+namespace idle
+{
+namespace
+{
+
+bool verify_file_extension(const char * const fn) noexcept
+{
+    auto chk = fn;
+    for (; *chk; ++chk);
+    for (; chk != fn && *chk != '.'; --chk);
+    return ::strcmp(chk, ".png") == 0;
+}
+
+}  // namespace
+
+png_image_data::png_image_data(const char * fn, const bool pad_to_power_of_two) noexcept
+{
+    if (verify_file_extension(fn))
+    {
+        if (const auto b = platform::asset::hold(fn))
+        {
+            decode(b.view(), pad_to_power_of_two);
+        }
+    }
+}
+
+}  // namespace idle
@@ -0,0 +1,123 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+
+#include "shelf_packer.hpp"
+
+namespace idle::images
+{
+
+std::optional<shelf_packer::region> shelf_packer::allocate_on(shelf& s, const unsigned width, const unsigned height) noexcept
+{
+    for (auto hole = s.holes.begin(); hole != s.holes.end(); ++hole)
+    {
+        if (hole->width < width)
+            continue;
+
+        const region out{ hole->x, s.y, width, height };
+        hole->x += width;
+        hole->width -= width;
+        if (!hole->width)
+            s.holes.erase(hole);
+        ++s.live;
+        return out;
+    }
+
+    if (s.end + width > size)
+        return {};
+
+    const region out{ s.end, s.y, width, height };
+    s.end += width;
+    ++s.live;
+    return out;
+}
+
+std::optional<shelf_packer::region> shelf_packer::allocate(const unsigned width, const unsigned height) noexcept
+{
+    if (!width || !height || width > size || height > size)
+        return {};
+
+    for (auto& s : shelves)
+    {
+        if (s.height >= height && s.height - height <= height / 4 + 2)
+            if (auto out = allocate_on(s, width, height))
+                return out;
+    }
+
+    if (top + height <= size)
+    {
+        auto& s = shelves.emplace_back(shelf{ top, height });
+        top += height;
+        return allocate_on(s, width, height);
+    }
+
+    for (auto& s : shelves)
+    {
+        if (s.height >= height)
+            if (auto out = allocate_on(s, width, height))
+                return out;
+    }
+    return {};
+}
+
+void shelf_packer::release(const region& r) noexcept
+{
+    const auto s = std::find_if(shelves.begin(), shelves.end(), [&r](const shelf& it) { return it.y == r.y; });
+    if (s == shelves.end() || !s->live)
+        return;
+
+    if (!--s->live)
+    {
+        s->holes.clear();
+        s->end = 0;
+    }
+    else
+    {
+        auto& holes = s->holes;
+        holes.insert(std::lower_bound(holes.begin(), holes.end(), r.x,
+                    [](const span& h, const unsigned x) { return h.x < x; }),
+                span{ r.x, r.width });
+
+        auto merged = holes.begin();
+        for (auto it = std::next(merged); it != holes.end(); ++it)
+        {
+            if (merged->x + merged->width == it->x)
+                merged->width += it->width;
+            else
+                *++merged = *it;
+        }
+        holes.erase(std::next(merged), holes.end());
+
+        if (holes.back().x + holes.back().width == s->end)
+        {
+            s->end = holes.back().x;
+            holes.pop_back();
+        }
+    }
+
+    while (!shelves.empty() && !shelves.back().live)
+    {
+        top = shelves.back().y;
+        shelves.pop_back();
+    }
+}
+
+}  // namespace idle::images
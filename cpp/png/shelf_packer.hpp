@@ -0,0 +1,67 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <optional>
+#include <vector>
+
+namespace idle::images
+{
+
+// Rows of regions in a square page; released space becomes holes on its shelf, and shelves
+// left empty at the top are handed back
+class shelf_packer
+{
+public:
+    struct region
+    {
+        unsigned x, y, width, height;
+    };
+
+    explicit shelf_packer(unsigned side) noexcept : size(side) {}
+
+    std::optional<region> allocate(unsigned width, unsigned height) noexcept;
+
+    void release(const region& r) noexcept;
+
+    bool empty() const noexcept
+    {
+        return shelves.empty();
+    }
+
+private:
+    struct span
+    {
+        unsigned x, width;
+    };
+
+    struct shelf
+    {
+        unsigned y, height, end = 0, live = 0;
+        std::vector<span> holes;
+    };
+
+    unsigned size, top = 0;
+    std::vector<shelf> shelves;
+
+    std::optional<region> allocate_on(shelf& s, unsigned width, unsigned height) noexcept;
+};
+
+}  // namespace idle::images
@@ -0,0 +1,164 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Converts PNG assets into texture files next to them, see texture_file.hpp
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+
+#include "png.hpp"
+#include "texture_file.hpp"
+#include "lz4_block.hpp"
+
+namespace
+{
+
+struct options
+{
+    bool force = false, pad = false, compress = false;
+};
+
+using file_ptr = std::unique_ptr<FILE, decltype([](FILE* f){ std::fclose(f); })>;
+
+bool is_up_to_date(const char * const input, const std::string& output) noexcept
+{
+    struct stat in, out;
+    return ::stat(input, &in) == 0 && ::stat(output.c_str(), &out) == 0
+        && out.st_mtime >= in.st_mtime;
+}
+
+std::string read_file(const char * const path) noexcept
+{
+    std::string out;
+    if (const file_ptr f{ std::fopen(path, "rb") })
+    {
+        char buffer[1 << 16];
+        for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f.get())) > 0;)
+            out.append(buffer, n);
+    }
+    return out;
+}
+
+bool convert(const char * const input, const options& opts) noexcept
+{
+    const auto output = idle::images::texture_file::name_for(input);
+    if (!opts.force && is_up_to_date(input, output))
+        return true;
+
+    const auto source = read_file(input);
+    const auto picture = idle::png_image_data::from_memory(source, opts.pad);
+    if (!picture.image)
+    {
+        std::fprintf(stderr, "%s: cannot decode\n", input);
+        return false;
+    }
+
+    const std::size_t stored_size = std::size_t{ picture.real_width } * picture.real_height * picture.size;
+    std::vector<unsigned char> packed;
+    if (opts.compress)
+        packed = idle::images::lz4_compress(picture.image.get(), stored_size);
+
+    // Compression that does not pay for itself is not worth decoding
+    const bool use_lz4 = opts.compress && packed.size() < stored_size - stored_size / 8;
+
+    idle::images::texture_file_header header{};
+    std::memcpy(header.magic, idle::images::texture_file_header::signature, sizeof(header.magic));
+    header.version = idle::images::texture_file_header::current_version;
+    header.channels = static_cast<std::uint8_t>(picture.size);
+    header.compression = use_lz4 ? idle::images::texture_file_header::lz4 : idle::images::texture_file_header::raw;
+    header.width = picture.width;
+    header.height = picture.height;
+    header.stored_width = picture.real_width;
+    header.stored_height = picture.real_height;
+    header.payload_size = static_cast<std::uint32_t>(use_lz4 ? packed.size() : stored_size);
+
+    const auto temporary = output + ".tmp";
+    {
+        const file_ptr f{ std::fopen(temporary.c_str(), "wb") };
+        if (!f
+                || std::fwrite(&header, sizeof(header), 1, f.get()) != 1
+                || std::fwrite(use_lz4 ? packed.data() : picture.image.get(), 1, header.payload_size, f.get()) != header.payload_size
+                || std::fflush(f.get()) != 0)
+        {
+            std::fprintf(stderr, "%s: cannot write\n", temporary.c_str());
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporary.c_str(), output.c_str()) != 0)
+    {
+        std::fprintf(stderr, "%s: cannot write\n", output.c_str());
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    std::printf("%s -> %s (%ux%u, %u KB%s)\n", input, output.c_str(),
+            picture.width, picture.height, header.payload_size / 1024, use_lz4 ? ", lz4" : "");
+    return true;
+}
+
+int usage(const char * const self) noexcept
+{
+    std::fprintf(stderr, "usage: %s [-fpz] picture.png...\n"
+            "  -f  convert even when the output is newer\n"
+            "  -p  pad to power of two dimensions\n"
+            "  -z  compress pixels with lz4\n", self);
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+    options opts;
+    int failures = 0, files = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i][0] == '-')
+        {
+            for (const char * c = argv[i] + 1; *c; ++c)
+            {
+                switch (*c)
+                {
+                    case 'f': opts.force = true; break;
+                    case 'p': opts.pad = true; break;
+                    case 'z': opts.compress = true; break;
+                    default:
+                        return usage(argv[0]);
+                }
+            }
+            continue;
+        }
+
+        ++files;
+        if (!convert(argv[i], opts))
+            ++failures;
+    }
+
+    if (!files)
+        return usage(argv[0]);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+#include <log.hpp>
+
+#include "texture_file.hpp"
+#include "lz4_block.hpp"
+#include "../platform/asset_access.hpp"
+
+namespace idle::images
+{
+namespace
+{
+
+constexpr bool is_power_of_two(const unsigned n) noexcept
+{
+    return n && !(n & (n - 1));
+}
+
+unsigned next_power_of_two(const unsigned n) noexcept
+{
+    unsigned out = 1;
+    while (out < n) out *= 2;
+    return out;
+}
+
+}  // namespace
+
+std::optional<texture_file> texture_file::open(const char * const png_name, const bool pad_to_power_of_two) noexcept
+{
+    const auto name = name_for(png_name);
+    auto file = std::make_shared<platform::asset>(platform::asset::hold_if_present(name.c_str()));
+    if (!*file)
+        return {};
+
+    const auto view = file->view();
+    texture_file_header header;
+    if (view.size() < sizeof(header))
+    {
+        LOGE("'%s' is too short", name.c_str());
+        return {};
+    }
+    ::memcpy(&header, view.data(), sizeof(header));
+
+    const auto payload = reinterpret_cast<const unsigned char*>(view.data()) + sizeof(header);
+    const std::size_t stored_size = std::size_t{ header.stored_width } * header.stored_height * header.channels;
+
+    if (::memcmp(header.magic, texture_file_header::signature, sizeof(header.magic)) != 0
+            || header.version != texture_file_header::current_version
+            || (header.channels != 3 && header.channels != 4)
+            || !header.width || !header.height
+            || header.stored_width < header.width || header.stored_height < header.height
+            || header.payload_size != view.size() - sizeof(header)
+            || (header.compression == texture_file_header::raw && header.payload_size != stored_size)
+            || header.compression > texture_file_header::lz4)
+    {
+        LOGE("'%s' is not a texture file this build understands, ignoring it", name.c_str());
+        return {};
+    }
+
+    texture_file out
+    {
+        header.width, header.height,
+        header.stored_width, header.stored_height,
+        header.channels,
+        payload,
+        file
+    };
+
+    std::shared_ptr<unsigned char[]> unpacked;
+    if (header.compression == texture_file_header::lz4)
+    {
+        unpacked.reset(new unsigned char[stored_size]);
+        if (!lz4_decompress(payload, header.payload_size, unpacked.get(), stored_size))
+        {
+            LOGE("'%s' has a damaged payload", name.c_str());
+            return {};
+        }
+        out.pixels = unpacked.get();
+        out.storage = unpacked;
+    }
+
+    // Contexts without NPOT textures still get padded rows, at the cost of a copy
+    if (pad_to_power_of_two && !(is_power_of_two(out.stored_width) && is_power_of_two(out.stored_height)))
+    {
+        const unsigned w = next_power_of_two(out.width), h = next_power_of_two(out.height);
+        const std::size_t row = std::size_t{ out.width } * out.channels, stride = std::size_t{ w } * out.channels;
+        std::shared_ptr<unsigned char[]> padded{ new unsigned char[stride * h]() };
+
+        for (unsigned y = 0; y < out.height; ++y)
+            ::memcpy(padded.get() + stride * y, out.pixels + std::size_t{ out.stored_width } * out.channels * y, row);
+
+        out.stored_width = w;
+        out.stored_height = h;
+        out.pixels = padded.get();
+        out.storage = std::move(padded);
+    }
+
+    return out;
+}
+
+}  // namespace idle::images
@@ -0,0 +1,76 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace idle::images
+{
+
+// Pictures converted ahead of time, so that loading one is a matter of mapping
+// the file and handing its pixels to GL. Rows are stored tightly, or padded out
+// to stored_width when the converter was asked to pad.
+struct texture_file_header
+{
+    static constexpr char signature[4] { 'I', 'D', 'T', 'X' };
+    static constexpr std::uint16_t current_version = 1;
+
+    enum : std::uint8_t
+    {
+        raw,
+        lz4
+    };
+
+    char magic[4];
+    std::uint16_t version;
+    std::uint8_t channels;
+    std::uint8_t compression;
+    std::uint32_t width, height;
+    std::uint32_t stored_width, stored_height;
+    std::uint32_t payload_size;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(texture_file_header) == 32);
+
+struct texture_file
+{
+    unsigned width, height, stored_width, stored_height, channels;
+    const unsigned char * pixels;
+
+    // Keeps whatever pixels points into alive, be it the mapped file or an unpacked copy
+    std::shared_ptr<const void> storage;
+
+    // The converted sibling of a PNG asset, "a/b.png" looks for "a/b.itx"
+    static std::string name_for(const std::string_view png_name) noexcept
+    {
+        std::string out{ png_name.substr(0, png_name.rfind('.')) };
+        out += ".itx";
+        return out;
+    }
+
+    static std::optional<texture_file> open(const char * png_name, bool pad_to_power_of_two) noexcept;
+};
+
+}  // namespace idle::images
@@ -0,0 +1,256 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <log.hpp>
+#include "platform/asset_access.hpp"
+#include "cache_file.hpp"
+#include "program_cache.hpp"
+
+namespace graphics
+{
+
+namespace
+{
+
+constexpr char file_magic[4] { 'I', 'P', 'B', 'C' };
+constexpr std::uint32_t file_version = 3;  // 3: attr_keyframes pinned
+constexpr std::uint32_t max_binary_size = 16 * 1024 * 1024;
+
+struct file_header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t count;
+    std::uint32_t reserved;
+};
+
+struct entry_header
+{
+    std::uint32_t vertex, fragment, format, size;
+};
+
+namespace cache_file = idle::cache_file;
+
+using cache_file::unique_file;
+using cache_file::hash_offset;
+using cache_file::hash;
+
+std::string_view gl_string(const GLenum name) noexcept
+{
+    const auto str = reinterpret_cast<const char*>(gl::GetString(name));
+    return str ? std::string_view{ str } : std::string_view{};
+}
+
+void drain_errors() noexcept
+{
+    while (gl::GetError() != gl::NO_ERROR_) {}
+}
+
+}  // namespace
+
+void program_cache::open(const std::string_view shader_source) noexcept
+{
+    entries.clear();
+    loaded = rejected = stored = 0;
+    enabled = false;
+
+    if (!gl::GetProgramBinary || !gl::ProgramBinary)
+        return;
+
+    GLint formats = 0;
+    gl::GetIntegerv(gl::NUM_PROGRAM_BINARY_FORMATS, &formats);
+    drain_errors();
+
+    if (formats <= 0)
+    {
+        LOGD("Program binaries are not supported by the driver");
+        return;
+    }
+
+    path = platform::cache_path("programs.bin");
+
+    if (path.empty())
+        return;
+
+    key = hash_offset;
+    key = hash(key, gl_string(gl::VENDOR));
+    key = hash(key, gl_string(gl::RENDERER));
+    key = hash(key, gl_string(gl::VERSION));
+    key = hash(key, shader_source);
+    enabled = true;
+
+    if (!read())
+        entries.clear();
+}
+
+bool program_cache::read() noexcept
+{
+    const unique_file f{ std::fopen(path.c_str(), "rb") };
+
+    if (!f)
+        return false;
+
+    file_header header;
+
+    if (std::fread(&header, sizeof(header), 1, f.get()) != 1
+            || std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0
+            || header.version != file_version)
+    {
+        LOGW("Program cache \"%s\" is unreadable", path.c_str());
+        return false;
+    }
+
+    if (header.key != key)
+    {
+        LOGI("Program cache is stale, shaders will be rebuilt");
+        return false;
+    }
+
+    entries.reserve(header.count);
+
+    for (std::uint32_t i = 0; i < header.count; ++i)
+    {
+        entry_header eh;
+
+        if (std::fread(&eh, sizeof(eh), 1, f.get()) != 1 || !eh.size || eh.size > max_binary_size)
+            return false;
+
+        auto& it = entries.emplace_back(entry{ eh.vertex, eh.fragment, static_cast<GLenum>(eh.format), {} });
+        it.binary.resize(eh.size);
+
+        if (std::fread(it.binary.data(), 1, eh.size, f.get()) != eh.size)
+            return false;
+    }
+
+    return true;
+}
+
+bool program_cache::is_enabled() const noexcept
+{
+    return enabled;
+}
+
+GLuint program_cache::load(const unsigned vertex, const unsigned fragment) noexcept
+{
+    if (!enabled)
+        return 0;
+
+    const auto it = std::find_if(entries.begin(), entries.end(),
+            [vertex, fragment](const entry& e) { return e.vertex == vertex && e.fragment == fragment; });
+
+    if (it == entries.end())
+        return 0;
+
+    if (const GLuint program = gl::CreateProgram())
+    {
+        gl::ProgramBinary(program, it->format, it->binary.data(), static_cast<GLsizei>(it->binary.size()));
+
+        GLint status = gl::FALSE_;
+        gl::GetProgramiv(program, gl::LINK_STATUS, &status);
+
+        if (status == gl::TRUE_)
+        {
+            ++loaded;
+            return program;
+        }
+
+        gl::DeleteProgram(program);
+    }
+
+    // Typically after a driver update that kept the version strings
+    drain_errors();
+    entries.erase(it);
+    ++rejected;
+    return 0;
+}
+
+void program_cache::store(const GLuint program, const unsigned vertex, const unsigned fragment) noexcept
+{
+    if (!enabled)
+        return;
+
+    GLint length = 0;
+    gl::GetProgramiv(program, gl::PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0 || static_cast<std::uint32_t>(length) > max_binary_size)
+    {
+        drain_errors();
+        return;
+    }
+
+    entry e{ vertex, fragment, 0, {} };
+    e.binary.resize(static_cast<std::size_t>(length));
+
+    GLsizei written = 0;
+    gl::GetProgramBinary(program, length, &written, &e.format, e.binary.data());
+
+    if (written <= 0)
+    {
+        drain_errors();
+        return;
+    }
+
+    e.binary.resize(static_cast<std::size_t>(written));
+    entries.push_back(std::move(e));
+    ++stored;
+}
+
+void program_cache::save() noexcept
+{
+    if (!enabled)
+        return;
+
+    if (!stored && !rejected)
+        return;
+
+    const bool good = cache_file::replace(path, [this](FILE* const f)
+        {
+            file_header header{};
+            std::memcpy(header.magic, file_magic, sizeof(file_magic));
+            header.version = file_version;
+            header.key = key;
+            header.count = static_cast<std::uint32_t>(entries.size());
+
+            if (std::fwrite(&header, sizeof(header), 1, f) != 1)
+                return false;
+
+            for (const auto& it : entries)
+            {
+                const entry_header eh{ it.vertex, it.fragment, it.format, static_cast<std::uint32_t>(it.binary.size()) };
+                if (std::fwrite(&eh, sizeof(eh), 1, f) != 1
+                        || std::fwrite(it.binary.data(), 1, it.binary.size(), f) != it.binary.size())
+                    return false;
+            }
+            return true;
+        });
+
+    if (good)
+    {
+        LOGD("Program cache saved, %u loaded, %u rejected, %u built from source", loaded, rejected, stored);
+        stored = rejected = 0;
+    }
+}
+
+}  // namespace graphics
+
@@ -0,0 +1,66 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "platform/opengl_core_adaptive.hpp"
+
+namespace graphics
+{
+
+// Linked program binaries kept from an earlier run, keyed by the driver strings and the embedded shader sources.
+// Programs are identified by the source offsets of their vertex and fragment shaders.
+class program_cache
+{
+    struct entry
+    {
+        std::uint32_t vertex, fragment;
+        GLenum format;
+        std::vector<unsigned char> binary;
+    };
+
+    std::string path;
+    std::uint64_t key = 0;
+    std::vector<entry> entries;
+    unsigned loaded = 0, rejected = 0, stored = 0;
+    bool enabled = false;
+
+    bool read() noexcept;
+
+public:
+    // Drops whatever was kept for the previous context
+    void open(std::string_view shader_source) noexcept;
+
+    bool is_enabled() const noexcept;
+
+    // Zero when there is no binary or the driver rejects it, the program then has to be built from source
+    GLuint load(unsigned vertex, unsigned fragment) noexcept;
+
+    // The program should have been linked with PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void store(GLuint program, unsigned vertex, unsigned fragment) noexcept;
+
+    // Rewrites the file when anything had to be built from source
+    void save() noexcept;
+};
+
+}  // namespace graphics
+
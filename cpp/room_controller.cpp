@@ -23,6 +23,8 @@
 
 #include "room_controller.hpp"
 #include "draw_text.hpp"
+#include "platform/asset_access.hpp"
+#include "png/texture_file.hpp"
 
 namespace idle
 {
@@ -88,10 +90,10 @@ void controller::draw_frame(const graphics::core& gl) noexcept
 {
     if (haiku.has_crashed())
     {
-        gl.prog.text.use();
-        gl.prog.text.set_color({1, 1, 1, .9f});
+        gl.prog.sdf_text.use();
+        gl.prog.sdf_text.set_color({1, 1, 1, .9f});
 
-        draw_text<text_align::center, text_align::center>(*gl.fonts.regular, gl.prog.text,
+        draw_text<text_align::center, text_align::center>(*gl.fonts.regular, gl.prog.sdf_text,
                 haiku.get_string(), gl.draw_size / 2.f, 28);
     }
     else
@@ -110,6 +112,24 @@ void controller::draw_frame(const graphics::core& gl) noexcept
     }
 }
 
+namespace
+{
+
+// Reads the pictures of the room ahead while the current one winds down
+template<typename Room>
+void warm_up_assets() noexcept
+{
+    platform::asset::drop_prefetched();
+
+    if constexpr(idle_has_member(Room, manifest))
+    {
+        for (const char * const picture : Room::manifest)
+            platform::asset::prefetch(images::texture_file::name_for(picture), picture);
+    }
+}
+
+}  // namespace
+
 void controller::awaken(const std::chrono::steady_clock::time_point clock) noexcept
 {
     using namespace std::chrono_literals;
@@ -147,6 +167,7 @@ void controller::awaken(const std::chrono::steady_clock::time_point clock) noexc
                                 }
                                 else if constexpr (is_hotel_room<type>::value)
                                 {
+                                    warm_up_assets<typename type::opened_type>();
                                     next_variant.rooms.emplace(door<typename type::opened_type>{});
                                 }
                                 else
@@ -202,6 +223,7 @@ std::optional<hotel::keyring::variant> controller::do_step(const pointer_wrapper
             {
                 using T = typename idle_remove_cvr(gate)::opened_type;
                 LOGI("Switching context to: %s", room_label<T>);
+                platform::asset::log_prefetch_counters();
 
                 static_assert(std::is_constructible_v<T>);
                 auto& variant = gate.open(current_variant);
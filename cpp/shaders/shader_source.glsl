@@ -59,38 +59,61 @@ void main() {
   gl_FragColor = modified * mask;
 }
 
-@@ simpleblurf
+@@ kawasedownf
 
 #ifdef GL_ES
 precision mediump float;
 #endif
 uniform sampler2D u_tex;
 varying vec2 var_mapped_vec;
-uniform vec2 u_direction;
-uniform float u_radius, u_resolution;
+uniform vec2 u_halfpixel, u_limit;
+uniform float u_offset;
+
+vec4 tap(vec2 coords) {
+  return texture2D(u_tex, min(coords, u_limit));
+}
 
 void main() {
-  vec4 sum = vec4(0.0);
   vec2 tc = var_mapped_vec;
+  vec2 d = u_halfpixel * u_offset;
 
-  float blur = u_radius * u_resolution;
+  vec4 sum = tap(tc) * 4.0;
+  sum += tap(tc - d);
+  sum += tap(tc + d);
+  sum += tap(tc + vec2(d.x, -d.y));
+  sum += tap(tc - vec2(d.x, -d.y));
 
-  float hstep = u_direction.x * blur;
-  float vstep = u_direction.y * blur;
+  gl_FragColor = sum / 8.0;
+}
 
-  sum += texture2D(u_tex, vec2(tc.x - 4.0 * hstep, tc.y - 4.0 * vstep)) * 0.0162162162;
-  sum += texture2D(u_tex, vec2(tc.x - 3.0 * hstep, tc.y - 3.0 * vstep)) * 0.0540540541;
-  sum += texture2D(u_tex, vec2(tc.x - 2.0 * hstep, tc.y - 2.0 * vstep)) * 0.1216216216;
-  sum += texture2D(u_tex, vec2(tc.x - hstep, tc.y - vstep)) * 0.1945945946;
+@@ kawaseupf
 
-  sum += texture2D(u_tex, vec2(tc.x, tc.y)) * 0.2270270270;
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D u_tex;
+varying vec2 var_mapped_vec;
+uniform vec2 u_halfpixel, u_limit;
+uniform float u_offset;
 
-  sum += texture2D(u_tex, vec2(tc.x + hstep, tc.y + vstep)) * 0.1945945946;
-  sum += texture2D(u_tex, vec2(tc.x + 2.0 * hstep, tc.y + 2.0 * vstep)) * 0.1216216216;
-  sum += texture2D(u_tex, vec2(tc.x + 3.0 * hstep, tc.y + 3.0 * vstep)) * 0.0540540541;
-  sum += texture2D(u_tex, vec2(tc.x + 4.0 * hstep, tc.y + 4.0 * vstep)) * 0.0162162162;
+vec4 tap(vec2 coords) {
+  return texture2D(u_tex, min(coords, u_limit));
+}
 
-  gl_FragColor = sum;
+void main() {
+  vec2 tc = var_mapped_vec;
+  vec2 d = u_halfpixel * u_offset;
+
+  vec4 sum = tap(tc + vec2(-d.x * 2.0, 0.0));
+  sum += tap(tc + vec2(-d.x, d.y)) * 2.0;
+  sum += tap(tc + vec2(0.0, d.y * 2.0));
+  sum += tap(tc + vec2(d.x, d.y)) * 2.0;
+  sum += tap(tc + vec2(d.x * 2.0, 0.0));
+  sum += tap(tc + vec2(d.x, -d.y)) * 2.0;
+  sum += tap(tc + vec2(0.0, -d.y * 2.0));
+  sum += tap(tc + vec2(-d.x, -d.y)) * 2.0;
+
+  gl_FragColor = sum / 12.0;
 }
 
 @@ normv
@@ -168,6 +191,27 @@ void main() {
     gl_Position = u_projm * u_viewm * u_modelm * vec4(pos, 0.0, 1.0);
 }
 
+@@ doubleinstv
+
+attribute vec2 attr_pos, attr_mapped_vec;  // x of attr_pos is the column of the keyframe table
+attribute vec3 attr_instance;  // translation, interpolate value
+attribute vec3 attr_keyframes;  // rows of both keyframes, texture shift
+uniform mat4 u_projm, u_viewm, u_modelm;
+varying vec2 var_mapped_vec;
+uniform vec2 u_map_shift1, u_map_shift2, u_map_mult;
+uniform sampler2D u_keyframes;
+uniform vec2 u_keyframes_size;
+
+vec2 keyframe(float row) {
+    return texture2DLod(u_keyframes, (vec2(attr_pos.x, row) + 0.5) / u_keyframes_size, 0.0).xy;
+}
+
+void main() {
+    var_mapped_vec = (attr_mapped_vec + u_map_shift1) * u_map_mult + u_map_shift2 + vec2(attr_keyframes.z, 0.0);
+    vec2 pos = mix(keyframe(attr_keyframes.x), keyframe(attr_keyframes.y), attr_instance.z);
+    gl_Position = u_projm * u_viewm * (u_modelm * vec4(pos, 0.0, 1.0) + vec4(attr_instance.xy, 0.0, 0.0));
+}
+
 @@ solidv
 
 attribute vec2 attr_pos;
@@ -188,6 +232,38 @@ void main() {
     gl_FragColor = u_color;
 }
 
+@@ dualsolidv
+
+attribute vec2 attr_pos;
+attribute vec4 attr_view; // scale & offset of the target view within the masked buffer
+attribute float attr_view_mask;
+uniform mat4 u_projm, u_viewm, u_modelm;
+varying vec2 var_clip;
+varying float var_mask;
+
+void main() {
+    vec4 pos = u_projm * u_viewm * u_modelm * vec4(attr_pos, 0.0, 1.0);
+    var_clip = pos.xy / pos.w;
+    var_mask = attr_view_mask;
+    gl_Position = vec4(pos.xy * attr_view.xy + attr_view.zw * pos.w, pos.zw);
+}
+
+@@ dualsolidf
+
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform vec4 u_color, u_mask_color;
+varying vec2 var_clip;
+varying float var_mask;
+
+void main() {
+    // instances share one viewport, so each one is clipped to its own view here
+    if (max(abs(var_clip.x), abs(var_clip.y)) > 1.0)
+        discard;
+    gl_FragColor = mix(u_color, u_mask_color, var_mask);
+}
+
 @@ noisef  // linked with normv
 
 #ifdef GL_ES
@@ -214,15 +290,17 @@ void main() {
 
 @@ textv
 
-attribute vec2 attr_pos;
+attribute vec2 attr_pos; // glyph offsets are baked into the run
 uniform mat4 u_projm, u_viewm, u_modelm; // projection, scale (font-size), model
-uniform vec2 u_offset;
 attribute vec2 attr_mapped_vec;
+attribute vec4 attr_color;
 varying vec2 var_mapped_vec;
+varying vec4 var_color;
 
 void main() {
     var_mapped_vec = attr_mapped_vec;
-    gl_Position = u_projm * u_viewm * u_modelm * vec4(attr_pos + u_offset, 0.0, 1.0);
+    var_color = attr_color;
+    gl_Position = u_projm * u_viewm * u_modelm * vec4(attr_pos, 0.0, 1.0);
 }
 
 @@ textf
@@ -233,11 +311,80 @@ precision mediump float;
 uniform sampler2D u_tex;
 uniform vec4 u_color;
 varying vec2 var_mapped_vec;
+varying vec4 var_color;
+
+void main() {
+  float a = texture2D(u_tex, var_mapped_vec).x;
+  float c = 0.8 + (a * 0.2);
+  gl_FragColor = vec4(c, c, c, a) * u_color * var_color; // swizzling won't work on earlier OpenGL
+}
+
+@@ sdftextf
+
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D u_tex;
+uniform vec4 u_color, u_outline_color, u_glow_color;
+uniform float u_smoothing, u_outline_width, u_glow_width;
+varying vec2 var_mapped_vec;
+varying vec4 var_color;
+
+vec4 over(vec4 under, vec4 layer) { // premultiplied
+  return vec4(layer.rgb * layer.a + under.rgb * (1.0 - layer.a), layer.a + under.a * (1.0 - layer.a));
+}
+
+void main() {
+  float d = texture2D(u_tex, var_mapped_vec).x;
+  float edge = 0.5 - u_outline_width;
+  vec4 fill = u_color * var_color;
+  vec4 glow = vec4(u_glow_color.rgb, u_glow_color.a * smoothstep(edge - u_glow_width, edge, d));
+  vec4 outline = vec4(u_outline_color.rgb, u_outline_color.a * smoothstep(edge - u_smoothing, edge + u_smoothing, d));
+  vec4 body = vec4(fill.rgb, fill.a * smoothstep(0.5 - u_smoothing, 0.5 + u_smoothing, d));
+  vec4 p = over(over(vec4(glow.rgb * glow.a, glow.a), outline), body);
+  gl_FragColor = vec4(p.rgb / max(p.a, 0.001), p.a);
+}
+
+@@ dualtextv
+
+attribute vec2 attr_pos;
+uniform mat4 u_projm, u_viewm, u_modelm;
+attribute vec2 attr_mapped_vec;
+attribute vec4 attr_color;
+attribute vec4 attr_view;
+attribute float attr_view_mask;
+varying vec2 var_mapped_vec;
+varying vec4 var_color;
+varying vec2 var_clip;
+varying float var_mask;
+
+void main() {
+    var_mapped_vec = attr_mapped_vec;
+    var_color = attr_color;
+    vec4 pos = u_projm * u_viewm * u_modelm * vec4(attr_pos, 0.0, 1.0);
+    var_clip = pos.xy / pos.w;
+    var_mask = attr_view_mask;
+    gl_Position = vec4(pos.xy * attr_view.xy + attr_view.zw * pos.w, pos.zw);
+}
+
+@@ dualtextf
+
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D u_tex;
+uniform vec4 u_color, u_mask_color;
+varying vec2 var_mapped_vec;
+varying vec4 var_color;
+varying vec2 var_clip;
+varying float var_mask;
 
 void main() {
+  if (max(abs(var_clip.x), abs(var_clip.y)) > 1.0)
+      discard;
   float a = texture2D(u_tex, var_mapped_vec).x;
   float c = 0.8 + (a * 0.2);
-  gl_FragColor = vec4(c, c, c, a) * u_color; // swizzling won't work on earlier OpenGL
+  gl_FragColor = vec4(c, c, c, a) * mix(u_color, u_mask_color, var_mask) * var_color;
 }
 
 @@ fullbgf
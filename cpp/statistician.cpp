@@ -18,12 +18,63 @@
 */
 
 #include <cstdio>
+#include <cstring>
 #include "draw_text.hpp"
 #include "statistician.hpp"
 
 namespace idle::stats
 {
 
+namespace
+{
+
+constexpr std::array<color_t, graphics::gpu_pass_count> gpu_pass_colors
+{
+    color_t{ .35f, .6f, 1.f, .8f },
+    color_t{ .7f, .4f, 1.f, .8f },
+    color_t{ 1.f, .45f, .6f, .8f },
+    color_t{ 1.f, .733f, .496f, .8f },
+    color_t{ .5f, .9f, .5f, .8f }
+};
+
+// Stacked bar of the GPU time spent per pass, the mark at its end is one frame's worth of time
+void draw_gpu_bar(const graphics::core& gl, const graphics::gpu_pass_times& times) noexcept
+{
+    static constexpr point_t bar_origin{ 50.f, 12.f };
+    static constexpr point_t bar_size{ 200.f, 6.f };
+    constexpr float frame_milliseconds = 1000.f / application_frames_per_second;
+
+    const auto& prog = gl.prog.dual_fill;
+    prog.set_view_identity();
+    prog.position_vertex(square_coordinates);
+
+    float x = bar_origin.x;
+    for (std::size_t i = 0; i < times.milliseconds.size(); ++i)
+    {
+        const float width = times.milliseconds[i] / frame_milliseconds * bar_size.x;
+
+        if (width <= 0.f)
+            continue;
+
+        auto mat = math::matrices::scale<float>(point_t{ width, bar_size.y });
+        math::transform::translate(mat, point_t{ x, bar_origin.y });
+        prog.set_transform(mat);
+        prog.set_color(gpu_pass_colors[i]);
+        prog.set_mask_color(gpu_pass_colors[i]);
+        prog.draw_arrays(gl::TRIANGLE_STRIP, 0, 4);
+        x += width;
+    }
+
+    auto budget_mark = math::matrices::scale<float>(point_t{ 1.f, bar_size.y + 4.f });
+    math::transform::translate(budget_mark, point_t{ bar_origin.x + bar_size.x, bar_origin.y - 2.f });
+    prog.set_transform(budget_mark);
+    prog.set_color({1, 1, 1, .8f});
+    prog.set_mask_color({1, 1, 1, .8f});
+    prog.draw_arrays(gl::TRIANGLE_STRIP, 0, 4);
+}
+
+}  // namespace
+
 void statistician::count_fps(const std::chrono::high_resolution_clock::time_point start_point) noexcept
 {
     if (iter >= frame_count.size())
@@ -44,16 +95,20 @@ void statistician::draw_fps(const graphics::core& gl) const noexcept
 {
     gl::LineWidth(1.f);
 
-    gl.prog.fill.use();
-    gl.prog.fill.set_color({1, 1, 1, 0.5f});
-    gl.prog.fill.position_vertex(&frame_count.front().x);
-    gl.prog.fill.set_transform(math::matrices::scale<float>(gl.draw_size));
-    gl.prog.fill.set_view_identity();
+    const auto verts = gl.stream.allocate(sizeof(frame_count));
+    std::memcpy(verts.data, frame_count.data(), sizeof(frame_count));
+    gl.stream.flush();
+
+    const auto& prog = gl.prog.dual_fill;
+    prog.use();
+    prog.set_color({1, 1, 1, 0.5f});
+    prog.set_mask_color({1, 1, 1, 0.5f});
+    prog.position_vertex(verts.offset);
+    prog.set_transform(math::matrices::scale<float>(gl.draw_size));
+    prog.set_view_identity();
 
-    gl.view_mask();
-    gl::DrawArrays(gl::LINE_STRIP, 0, frame_count.size());
-    gl.view_normal();
-    gl::DrawArrays(gl::LINE_STRIP, 0, frame_count.size());
+    gl.draw_views(prog, [this, &prog] { prog.draw_arrays(gl::LINE_STRIP, 0, frame_count.size()); });
+    graphics::vertex_buffer::unbind();
 }
 
 void wall_clock::tick() noexcept
@@ -84,14 +139,60 @@ void wall_clock::tick() noexcept
 void wall_clock::draw_fps(const graphics::core& gl) const noexcept
 {
     static constexpr auto fps_draw_point = point_t{10.f, 10.f};
-    gl.prog.text.use();
-    gl.prog.text.set_color({1, .733f, .496f, .91f});
-    gl.view_mask();
-    draw_text<text_align::near, text_align::near>(
-            *gl.fonts.title, gl.prog.text, view, fps_draw_point, 10);
-    gl.view_normal();
-    draw_text<text_align::near, text_align::near>(
-            *gl.fonts.title, gl.prog.text, view, fps_draw_point, 10);
+    static constexpr auto stream_draw_point = point_t{10.f, 24.f};
+
+    const auto& stream = gl.stream.get_stats();
+    const auto& calls = graphics::state::last_frame();
+    const auto& targets = gl.render_targets.get_stats();
+    char stream_str[320];
+    auto written = std::snprintf(stream_str, sizeof(stream_str),
+            "vbo %.1fk (peak %.1fk) wrap %u grow %u\nprog %u/%u tex %u/%u unif %u/%u\nrt new %u reuse %u evict %u (%u out, %u idle)",
+            stream.bytes_last_frame / 1024.f, stream.peak_bytes_per_frame / 1024.f, stream.wraps, stream.grows,
+            calls.programs.issued, calls.programs.skipped,
+            calls.textures.issued, calls.textures.skipped,
+            calls.uniforms.issued, calls.uniforms.skipped,
+            targets.created, targets.reused, targets.evicted, targets.leased, targets.pooled);
+
+#ifdef IDLE_COMPILE_GL_TRACE
+    const auto& traced = gl::trace::LastFrame();
+    written += std::snprintf(stream_str + written, sizeof(stream_str) - written,
+            "\ngl %u calls, %u draws, %llu verts, %u state, %u unif, %u tex",
+            traced.calls, traced.drawCalls, traced.vertices, traced.stateChanges, traced.uniformUploads, traced.textureBinds);
+#endif
+
+    const auto& gpu = gl.timer.last_frame();
+    const bool gpu_timed = gl.timer.is_enabled() && gpu.valid;
+
+    if (gpu_timed)
+    {
+        written += std::snprintf(stream_str + written, sizeof(stream_str) - written, "\ngpu");
+
+        for (std::size_t i = 0; i < gpu.milliseconds.size() && written < static_cast<int>(sizeof(stream_str)); ++i)
+        {
+            written += std::snprintf(stream_str + written, sizeof(stream_str) - written, " %s %.2f",
+                    graphics::gpu_timer::name(static_cast<graphics::gpu_pass>(i)), gpu.milliseconds[i]);
+        }
+
+        if (written < static_cast<int>(sizeof(stream_str)))
+            std::snprintf(stream_str + written, sizeof(stream_str) - written, " ms, late %u", gpu.dropped_frames);
+    }
+
+    constexpr color_t text_color{1, .733f, .496f, .91f};
+    const auto& text = gl.prog.dual_text;
+    text.use();
+    text.set_color(text_color);
+    text.set_mask_color(text_color);
+
+    gl.draw_views(text, [this, &gl, &text, &stream_str]
+    {
+        draw_text<text_align::near, text_align::near>(
+                *gl.fonts.title, text, view, fps_draw_point, 10);
+        draw_text<text_align::near, text_align::near>(
+                *gl.fonts.title, text, stream_str, stream_draw_point, 8);
+    });
+
+    if (gpu_timed)
+        gl.draw_views(gl.prog.dual_fill, [&gl, &gpu] { draw_gpu_bar(gl, gpu); });
 }
 
 }  // namespace idle::stats
@@ -0,0 +1,254 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "interface.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <zlib.hpp>
+#include <png/png.hpp>
+
+namespace
+{
+
+// Reaches the lodepng decode the streamed one falls back to, it always yields RGBA
+struct lodepng_reference : idle::png_base_data
+{
+    std::vector<unsigned char> decode(const std::string& file) noexcept
+    {
+        return decode_png_buffer(reinterpret_cast<const unsigned char*>(file.data()), file.size());
+    }
+};
+
+struct picture
+{
+    unsigned width, height, channels;
+    std::vector<unsigned char> pixels;
+};
+
+picture sample_picture(const unsigned width, const unsigned height, const unsigned channels)
+{
+    picture out{ width, height, channels, std::vector<unsigned char>(width * height * channels) };
+    unsigned state = width * 31 + height * 7 + channels;
+    for (std::size_t i = 0; i < out.pixels.size(); ++i)
+    {
+        // Gradients with some noise, so every filter has something to predict
+        state = state * 1103515245u + 12345u;
+        out.pixels[i] = static_cast<unsigned char>(i * 3 + (state >> 16) % 17);
+    }
+    return out;
+}
+
+unsigned char paeth(const int a, const int b, const int c)
+{
+    const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return static_cast<unsigned char>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Scanlines with their filter byte, filter_of picks the filter type of each row
+template<typename FilterOf>
+std::vector<unsigned char> filter_rows(const picture& pic, const FilterOf& filter_of)
+{
+    const unsigned row_length = pic.width * pic.channels, bpp = pic.channels;
+    std::vector<unsigned char> out;
+    out.reserve((row_length + 1) * pic.height);
+
+    for (unsigned y = 0; y < pic.height; ++y)
+    {
+        const auto row = pic.pixels.data() + y * row_length;
+        const auto prev = y ? row - row_length : nullptr;
+        const unsigned char filter = filter_of(y);
+        out.push_back(filter);
+
+        for (unsigned i = 0; i < row_length; ++i)
+        {
+            const int a = i >= bpp ? row[i - bpp] : 0, b = prev ? prev[i] : 0, c = i >= bpp && prev ? prev[i - bpp] : 0;
+            int predicted = 0;
+            switch (filter)
+            {
+                case 1: predicted = a; break;
+                case 2: predicted = b; break;
+                case 3: predicted = (a + b) / 2; break;
+                case 4: predicted = paeth(a, b, c); break;
+                default: break;
+            }
+            out.push_back(static_cast<unsigned char>(row[i] - predicted));
+        }
+    }
+    return out;
+}
+
+void put_be32(std::string& out, const std::uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>(value >> shift & 0xff));
+}
+
+void put_chunk(std::string& out, const char * type, const std::string_view data)
+{
+    put_be32(out, static_cast<std::uint32_t>(data.size()));
+    const auto start = out.size();
+    out.append(type, 4);
+    out.append(data);
+    put_be32(out, static_cast<std::uint32_t>(::crc32(0, reinterpret_cast<const Bytef*>(out.data() + start), static_cast<uInt>(out.size() - start))));
+}
+
+// The compressed stream is cut into IDAT chunks of idat_size bytes
+template<typename FilterOf>
+std::string encode(const picture& pic, const FilterOf& filter_of, const std::size_t idat_size)
+{
+    const auto filtered = filter_rows(pic, filter_of);
+    const auto compressed = idle::zlib<std::string>(filtered.data(), filtered.size(), true, false);
+    if (!compressed)
+        return {};
+
+    std::string out("\x89PNG\r\n\x1a\n", 8);
+
+    std::string header;
+    put_be32(header, pic.width);
+    put_be32(header, pic.height);
+    header += static_cast<char>(8);
+    header += static_cast<char>(pic.channels == 4 ? 6 : 2);
+    header.append(3, '\0');
+    put_chunk(out, "IHDR", header);
+
+    for (std::size_t i = 0; i < compressed->size(); i += idat_size)
+        put_chunk(out, "IDAT", std::string_view(*compressed).substr(i, idat_size));
+
+    put_chunk(out, "IEND", {});
+    return out;
+}
+
+bool matches_source(const idle::png_image_data& decoded, const picture& pic, const bool pad)
+{
+    if (!decoded.image || decoded.width != pic.width || decoded.height != pic.height || decoded.size != pic.channels)
+        return false;
+
+    unsigned rw = pic.width, rh = pic.height;
+    if (pad)
+    {
+        for (rw = 1; rw < pic.width; rw *= 2);
+        for (rh = 1; rh < pic.height; rh *= 2);
+    }
+    if (decoded.real_width != rw || decoded.real_height != rh)
+        return false;
+
+    const unsigned row_length = pic.width * pic.channels, stride = rw * pic.channels;
+    for (unsigned y = 0; y < rh; ++y)
+    {
+        const auto row = decoded.image.get() + y * stride;
+        for (unsigned i = 0; i < stride; ++i)
+        {
+            const unsigned char expected = y < pic.height && i < row_length ? pic.pixels[y * row_length + i] : 0;
+            if (row[i] != expected)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool matches_lodepng(const idle::png_image_data& decoded, const std::string& file)
+{
+    lodepng_reference reference{};
+    const auto rgba = reference.decode(file);
+    if (rgba.empty())
+    {
+        // Then the fallback cannot decode the sample either, the comparison with the source still holds
+        std::cout << "  lodepng could not decode the sample\n";
+        return true;
+    }
+
+    if (!decoded.image || reference.width != decoded.width || reference.height != decoded.height)
+        return false;
+
+    const unsigned stride = decoded.real_width * decoded.size;
+    for (unsigned y = 0; y < decoded.height; ++y)
+        for (unsigned x = 0; x < decoded.width; ++x)
+            if (std::memcmp(decoded.image.get() + y * stride + x * decoded.size, rgba.data() + (y * decoded.width + x) * 4, decoded.size) != 0)
+                return false;
+    return true;
+}
+
+template<typename FilterOf>
+unsigned streamed_mismatches(const picture& pic, const FilterOf& filter_of, const std::size_t idat_size)
+{
+    const auto file = encode(pic, filter_of, idat_size);
+    unsigned failed = 0;
+
+    for (const bool pad : { false, true })
+    {
+        const auto decoded = idle::png_image_data::from_memory(file, pad);
+        if (!matches_source(decoded, pic, pad) || !matches_lodepng(decoded, file))
+        {
+            std::cout << "  " << pic.width << 'x' << pic.height << 'x' << pic.channels
+                << ", IDAT of " << idat_size << (pad ? ", padded" : ", unpadded") << '\n';
+            ++failed;
+        }
+    }
+    return failed;
+}
+
+}  // namespace
+
+TEST(png_streamed_filters)
+{
+    for (const unsigned channels : { 3u, 4u })
+    {
+        const auto pic = sample_picture(13, 7, channels);
+        for (unsigned char filter = 0; filter < 5; ++filter)
+            for (const std::size_t idat_size : { std::size_t{ 1 }, std::size_t{ 5 }, std::size_t{ 64 }, std::size_t{ 1 } << 20 })
+                EXPECT_EQUAL(streamed_mismatches(pic, [filter](unsigned) { return filter; }, idat_size), 0u);
+    }
+}
+
+TEST(png_streamed_mixed_filters)
+{
+    for (const unsigned channels : { 3u, 4u })
+    {
+        for (const auto& [width, height] : { std::pair{ 1u, 1u }, std::pair{ 1u, 9u }, std::pair{ 33u, 17u }, std::pair{ 64u, 32u } })
+        {
+            const auto pic = sample_picture(width, height, channels);
+            EXPECT_EQUAL(streamed_mismatches(pic, [](unsigned y) { return static_cast<unsigned char>(y % 5); }, 7), 0u);
+        }
+    }
+}
+
+TEST(png_truncated_idat)
+{
+    const auto pic = sample_picture(20, 12, 4);
+    const auto file = encode(pic, [](unsigned y) { return static_cast<unsigned char>(y % 5); }, 16);
+    EXPECT_TRUE(idle::png_image_data::from_memory(file, false).image);
+
+    // Cut inside the IDAT chunks, then a stream that ends early with the chunks intact
+    for (const std::size_t cut : { std::size_t{ 50 }, file.size() / 2, file.size() - 40 })
+        EXPECT_FALSE(idle::png_image_data::from_memory(std::string_view(file).substr(0, cut), false).image);
+
+    const auto filtered = filter_rows(pic, [](unsigned) { return static_cast<unsigned char>(1); });
+    const auto compressed = idle::zlib<std::string>(filtered.data(), filtered.size() / 2, true, false);
+    EXPECT_TRUE(compressed.has_value());
+    if (!compressed)
+        return;
+
+    std::string short_stream = file.substr(0, 33);
+    put_chunk(short_stream, "IDAT", *compressed);
+    put_chunk(short_stream, "IEND", {});
+    EXPECT_FALSE(idle::png_image_data::from_memory(short_stream, false).image);
+    EXPECT_FALSE(idle::png_image_data::from_memory(short_stream, true).image);
+}
@@ -0,0 +1,147 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "interface.hpp"
+#include <png/shelf_packer.hpp>
+
+using idle::images::shelf_packer;
+
+namespace
+{
+
+bool overlap(const shelf_packer::region& a, const shelf_packer::region& b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width
+        && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+}  // namespace
+
+TEST(shelf_packer_rejects_bad_sizes)
+{
+    shelf_packer packer{ 64 };
+    EXPECT_FALSE(packer.allocate(0, 8).has_value());
+    EXPECT_FALSE(packer.allocate(8, 0).has_value());
+    EXPECT_FALSE(packer.allocate(65, 8).has_value());
+    EXPECT_FALSE(packer.allocate(8, 65).has_value());
+    EXPECT_TRUE(packer.empty());
+}
+
+TEST(shelf_packer_fills_without_overlap)
+{
+    shelf_packer packer{ 64 };
+    std::vector<shelf_packer::region> placed;
+
+    while (const auto r = packer.allocate(16, 16))
+        placed.push_back(*r);
+
+    EXPECT_EQUAL(placed.size(), 16u);
+    for (std::size_t i = 0; i < placed.size(); ++i)
+    {
+        EXPECT_TRUE(placed[i].x + placed[i].width <= 64 && placed[i].y + placed[i].height <= 64);
+        for (std::size_t j = i + 1; j < placed.size(); ++j)
+            EXPECT_FALSE(overlap(placed[i], placed[j]));
+    }
+}
+
+TEST(shelf_packer_shares_shelves_by_height)
+{
+    shelf_packer packer{ 64 };
+    const auto a = packer.allocate(10, 16);
+    const auto b = packer.allocate(10, 14);
+    const auto c = packer.allocate(10, 4);
+
+    EXPECT_TRUE(a && b && c);
+    if (!a || !b || !c)
+        return;
+
+    // Close enough in height to share, a much shorter one opens its own shelf
+    EXPECT_EQUAL(a->y, b->y);
+    EXPECT_EQUAL(b->x, 10u);
+    EXPECT_EQUAL(c->y, 16u);
+}
+
+TEST(shelf_packer_reuses_released_space)
+{
+    shelf_packer packer{ 64 };
+    const auto a = packer.allocate(16, 16);
+    const auto b = packer.allocate(16, 16);
+    const auto c = packer.allocate(16, 16);
+    EXPECT_TRUE(a && b && c);
+    if (!a || !b || !c)
+        return;
+
+    packer.release(*b);
+    const auto d = packer.allocate(16, 16);
+    EXPECT_TRUE(d && d->x == b->x && d->y == b->y);
+}
+
+TEST(shelf_packer_merges_holes)
+{
+    shelf_packer packer{ 64 };
+    const auto a = packer.allocate(16, 16);
+    const auto b = packer.allocate(16, 16);
+    const auto c = packer.allocate(16, 16);
+    const auto d = packer.allocate(16, 16);
+    EXPECT_TRUE(a && b && c && d);
+    if (!a || !b || !c || !d)
+        return;
+
+    // Two neighbouring holes only fit a wider picture once merged
+    packer.release(*b);
+    packer.release(*c);
+    const auto wide = packer.allocate(32, 16);
+    EXPECT_TRUE(wide && wide->x == b->x && wide->y == a->y);
+}
+
+TEST(shelf_packer_trims_the_shelf_end)
+{
+    shelf_packer packer{ 64 };
+    const auto a = packer.allocate(16, 16);
+    const auto b = packer.allocate(16, 16);
+    const auto c = packer.allocate(16, 16);
+    EXPECT_TRUE(a && b && c);
+    if (!a || !b || !c)
+        return;
+
+    // A hole at the end of the shelf gives its width back to the free tail
+    packer.release(*b);
+    packer.release(*c);
+    const auto wide = packer.allocate(48, 16);
+    EXPECT_TRUE(wide && wide->x == b->x && wide->y == a->y);
+}
+
+TEST(shelf_packer_empties)
+{
+    shelf_packer packer{ 64 };
+    const auto a = packer.allocate(16, 16);
+    const auto b = packer.allocate(16, 40);
+    EXPECT_TRUE(a && b);
+    if (!a || !b)
+        return;
+
+    packer.release(*a);
+    EXPECT_FALSE(packer.empty());
+    packer.release(*b);
+    EXPECT_TRUE(packer.empty());
+
+    // Every shelf is gone, so the full height is available again
+    const auto tall = packer.allocate(64, 64);
+    EXPECT_TRUE(tall && tall->x == 0 && tall->y == 0);
+}
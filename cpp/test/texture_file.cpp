@@ -0,0 +1,268 @@
+/*
+    Copyright © 2020 endorfina <dev.endorfina@outlook.com>
+
+    This file is part of Idle.
+
+    Idle is free software: you can study it, redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation, either version 3 of
+    the License, or (at your option) any later version.
+
+    Idle is distributed in the hope that it will be fun and useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Idle. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "interface.hpp"
+#include <cstring>
+#include <map>
+#include <string>
+#include <png/lz4_block.hpp>
+#include <png/texture_file.hpp>
+#include <platform/asset_access.hpp>
+
+// texture_file::open reads through platform::asset, served here from memory
+namespace
+{
+
+std::map<std::string, std::string> files;
+
+}  // namespace
+
+namespace platform
+{
+
+asset::asset(asset&& other) noexcept
+    : data(other.data), mapping(other.mapping)
+{
+    other.data = {};
+}
+
+asset::~asset() noexcept
+{
+}
+
+asset::operator bool() const noexcept
+{
+    return !!data.size();
+}
+
+std::string_view asset::view() const noexcept
+{
+    return data;
+}
+
+asset asset::hold_if_present(const char * path) noexcept
+{
+    const auto it = files.find(path);
+    if (it == files.end())
+        return {};
+    return { it->second, nullptr };
+}
+
+}  // namespace platform
+
+namespace
+{
+
+using idle::images::texture_file_header;
+
+std::vector<unsigned char> sample_pixels(const std::size_t size)
+{
+    std::vector<unsigned char> out(size);
+    for (std::size_t i = 0; i < size; ++i)
+        out[i] = static_cast<unsigned char>(i % 7 == 0 ? i / 7 : 0x40);
+    return out;
+}
+
+bool round_trips(const std::vector<unsigned char>& source)
+{
+    const auto block = idle::images::lz4_compress(source.data(), source.size());
+    std::vector<unsigned char> out(source.size());
+    return idle::images::lz4_decompress(block.data(), block.size(), out.data(), out.size()) && out == source;
+}
+
+texture_file_header make_header(const unsigned width, const unsigned height, const unsigned channels, const std::size_t payload_size)
+{
+    texture_file_header header{};
+    std::memcpy(header.magic, texture_file_header::signature, sizeof(header.magic));
+    header.version = texture_file_header::current_version;
+    header.channels = static_cast<std::uint8_t>(channels);
+    header.compression = texture_file_header::raw;
+    header.width = header.stored_width = width;
+    header.height = header.stored_height = height;
+    header.payload_size = static_cast<std::uint32_t>(payload_size);
+    return header;
+}
+
+void put(const char * name, const texture_file_header& header, const std::vector<unsigned char>& payload)
+{
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char*>(payload.data()), payload.size());
+    files[name] = std::move(contents);
+}
+
+}  // namespace
+
+TEST(lz4_round_trip)
+{
+    EXPECT_TRUE(round_trips({}));
+    EXPECT_TRUE(round_trips({ 1, 2, 3 }));
+    EXPECT_TRUE(round_trips(std::vector<unsigned char>(100000, 0x55)));
+    EXPECT_TRUE(round_trips(sample_pixels(70000)));
+
+    std::vector<unsigned char> noise(5000);
+    unsigned state = 1;
+    for (auto& it : noise)
+        it = static_cast<unsigned char>((state = state * 1103515245u + 12345u) >> 16);
+    EXPECT_TRUE(round_trips(noise));
+}
+
+TEST(lz4_compresses_repetition)
+{
+    const std::vector<unsigned char> source(4096, 0);
+    EXPECT_TRUE(idle::images::lz4_compress(source.data(), source.size()).size() < source.size() / 16);
+}
+
+TEST(lz4_truncated_block)
+{
+    const auto source = sample_pixels(4096);
+    const auto block = idle::images::lz4_compress(source.data(), source.size());
+    std::vector<unsigned char> out(source.size());
+
+    for (const std::size_t cut : { std::size_t{ 1 }, std::size_t{ 2 }, block.size() / 2, block.size() - 1 })
+        EXPECT_FALSE(idle::images::lz4_decompress(block.data(), block.size() - cut, out.data(), out.size()));
+}
+
+TEST(lz4_wrong_output_size)
+{
+    const auto source = sample_pixels(4096);
+    const auto block = idle::images::lz4_compress(source.data(), source.size());
+    std::vector<unsigned char> out(source.size() + 1);
+
+    EXPECT_FALSE(idle::images::lz4_decompress(block.data(), block.size(), out.data(), source.size() - 1));
+    EXPECT_FALSE(idle::images::lz4_decompress(block.data(), block.size(), out.data(), source.size() + 1));
+}
+
+TEST(lz4_corrupt_block)
+{
+    std::vector<unsigned char> out(64);
+
+    // A match reaching back before the start of the output
+    const unsigned char bad_offset[] { 0x10, 'a', 0x09, 0x00, 0x00 };
+    EXPECT_FALSE(idle::images::lz4_decompress(bad_offset, sizeof(bad_offset), out.data(), out.size()));
+
+    // Offset zero
+    const unsigned char zero_offset[] { 0x10, 'a', 0x00, 0x00, 0x00 };
+    EXPECT_FALSE(idle::images::lz4_decompress(zero_offset, sizeof(zero_offset), out.data(), out.size()));
+
+    // More literals announced than the block holds
+    const unsigned char short_literals[] { 0xf0, 0x20, 'a', 'b' };
+    EXPECT_FALSE(idle::images::lz4_decompress(short_literals, sizeof(short_literals), out.data(), out.size()));
+
+    // A match running past the end of the output
+    const unsigned char long_match[] { 0x1f, 'a', 0x01, 0x00, 0xff, 0x00 };
+    EXPECT_FALSE(idle::images::lz4_decompress(long_match, sizeof(long_match), out.data(), 16));
+}
+
+TEST(texture_file_raw)
+{
+    const auto pixels = sample_pixels(5 * 3 * 4);
+    put("raw.itx", make_header(5, 3, 4, pixels.size()), pixels);
+
+    const auto file = idle::images::texture_file::open("raw.png", false);
+    EXPECT_TRUE(file.has_value());
+    if (!file)
+        return;
+
+    EXPECT_EQUAL(file->width, 5u);
+    EXPECT_EQUAL(file->height, 3u);
+    EXPECT_EQUAL(file->channels, 4u);
+    EXPECT_TRUE(std::memcmp(file->pixels, pixels.data(), pixels.size()) == 0);
+}
+
+TEST(texture_file_lz4)
+{
+    const auto pixels = sample_pixels(16 * 16 * 3);
+    const auto block = idle::images::lz4_compress(pixels.data(), pixels.size());
+    auto header = make_header(16, 16, 3, block.size());
+    header.compression = texture_file_header::lz4;
+    put("packed.itx", header, block);
+
+    const auto file = idle::images::texture_file::open("packed.png", false);
+    EXPECT_TRUE(file.has_value());
+    if (file)
+        EXPECT_TRUE(std::memcmp(file->pixels, pixels.data(), pixels.size()) == 0);
+
+    auto damaged = block;
+    damaged.resize(damaged.size() - 3);
+    header.payload_size = static_cast<std::uint32_t>(damaged.size());
+    put("damaged.itx", header, damaged);
+    EXPECT_FALSE(idle::images::texture_file::open("damaged.png", false).has_value());
+}
+
+TEST(texture_file_padding)
+{
+    const auto pixels = sample_pixels(3 * 3 * 3);
+    put("odd.itx", make_header(3, 3, 3, pixels.size()), pixels);
+
+    const auto file = idle::images::texture_file::open("odd.png", true);
+    EXPECT_TRUE(file.has_value());
+    if (!file)
+        return;
+
+    EXPECT_EQUAL(file->stored_width, 4u);
+    EXPECT_EQUAL(file->stored_height, 4u);
+    for (unsigned y = 0; y < 3; ++y)
+        EXPECT_TRUE(std::memcmp(file->pixels + y * 4 * 3, pixels.data() + y * 3 * 3, 3 * 3) == 0);
+}
+
+TEST(texture_file_rejects_bad_headers)
+{
+    const auto pixels = sample_pixels(4 * 4 * 4);
+    const auto good = make_header(4, 4, 4, pixels.size());
+
+    const auto rejected = [&pixels](texture_file_header header)
+    {
+        put("bad.itx", header, pixels);
+        return !idle::images::texture_file::open("bad.png", false);
+    };
+
+    EXPECT_FALSE(rejected(good));
+
+    auto header = good;
+    header.magic[0] = 'X';
+    EXPECT_TRUE(rejected(header));
+
+    header = good;
+    header.version = texture_file_header::current_version + 1;
+    EXPECT_TRUE(rejected(header));
+
+    header = good;
+    header.channels = 2;
+    EXPECT_TRUE(rejected(header));
+
+    header = good;
+    header.width = 0;
+    EXPECT_TRUE(rejected(header));
+
+    header = good;
+    header.stored_width = 3;
+    EXPECT_TRUE(rejected(header));
+
+    header = good;
+    header.payload_size += 1;
+    EXPECT_TRUE(rejected(header));
+
+    header = good;
+    header.compression = texture_file_header::lz4 + 1;
+    EXPECT_TRUE(rejected(header));
+
+    files["short.itx"] = "IDTX";
+    EXPECT_FALSE(idle::images::texture_file::open("short.png", false).has_value());
+    EXPECT_FALSE(idle::images::texture_file::open("missing.png", false).has_value());
+}
@@ -107,3 +107,23 @@ then
     curl "${curl_opts[@]}" "${download_args[@]}"
 fi
 
+
+# Pre-decoded copies load much faster than the PNGs, whenever the converter has been built
+for converter in ../.cxx/out/idle-texconv ../idle-texconv
+do
+    if [[ -x $converter ]]
+    then
+        "$converter" "${ASSETS[@]}"
+        break
+    fi
+done
+
+# Refreshed files would otherwise sit behind a stale pack
+for packer in ../.cxx/out/idle-pack ../idle-pack
+do
+    if [[ -x $packer ]]
+    then
+        "$packer" ../assets.pak .
+        break
+    fi
+done